@@ -4,8 +4,10 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <math.h>
+#include <limits.h>
 
 #include "MyAsm.h"
+#include "../numeric.h"
 
 #define ANSI_COLOR_RED "\x1b[31m"
 #define ANSI_COLOR_GREEN "\x1b[32m"
@@ -39,6 +41,12 @@ char *makeName(char *original, char *ext);
 
 int parseRegister(const char *reg);
 
+int parseIndexRegister(const char *reg);
+
+bool isIndexOperand(const char *sarg);
+
+bool isFrameOperand(const char *sarg);
+
 char *
 generateMachineCode(FILE *source, int lines, int *fileSize, label_t *labels = NULL);
 
@@ -53,12 +61,31 @@ enum argumentTypes {
     RAM_IMMED,
     RAM_REG,
     RAM_REG_IMMED,
-    LABEL
+    LABEL,
+    PIXEL,
+    INDEX,
+    RAM_INDEX,
+    RAM_INDEX_IMMED,
+    INDEX_REG,
+    REG_INDEX,
+    REG_REG,
+    REG_NUMBER,
+    REG_LABEL,
+    INDEX_LABEL,
+    RAM_FRAME,
+    FIXED,
+    REG_FIXED,
+    NUMBER_NUMBER
 };
 
-const int REGS_NUM = 4;
+const int REGS_NUM = 16;
+const int INDEX_REGS_NUM = 4;
 const int REGNAME_LENGTH = 3;
 const int MAX_ARGS_NUM = 2;
+const int PIXEL_X_SHIFT = 16;
+const int PIXEL_Y_SHIFT = 4;
+const int PIXEL_X_MAX = 0x7FFF;
+const int PIXEL_Y_MAX = 0xFFF;
 
 int main(int argc, char *argv[]) {
     char *filename = nullptr;
@@ -82,6 +109,12 @@ int main(int argc, char *argv[]) {
     int lines = countLines(sourceCode, '\n');
     int fSize = 0;
     char *bin = generateMachineCode(source, lines, &fSize);
+    if (!bin) {
+        fclose(source);
+        free(sourceCode);
+        free(filename);
+        return -1;
+    }
     char *outputName = makeName(filename, (char *) ".bin");
 
 
@@ -118,7 +151,8 @@ char *makeName(char *original, char *ext) {
 }
 
 int parseRegister(const char *reg) {
-    char registers[REGS_NUM][REGNAME_LENGTH] = {"ax", "bx", "cx", "dx"};
+    char registers[REGS_NUM][REGNAME_LENGTH] = {"ax", "bx", "cx", "dx", "ex", "fx", "gx", "hx",
+                                                "ix", "jx", "kx", "lx", "mx", "nx", "ox", "px"};
     assert(reg);
 
     for (int i = 0; i < REGS_NUM; i++)
@@ -128,6 +162,32 @@ int parseRegister(const char *reg) {
     return -1;
 }
 
+int parseIndexRegister(const char *reg) {
+    char registers[INDEX_REGS_NUM][REGNAME_LENGTH] = {"ai", "bi", "ci", "di"};
+    assert(reg);
+
+    for (int i = 0; i < INDEX_REGS_NUM; i++)
+        if (strcmp(reg, registers[i]) == 0)
+            return i;
+
+    return -1;
+}
+
+bool isIndexOperand(const char *sarg) {
+    assert(sarg);
+
+    char reg[MAX_SARG_SIZE] = "";
+    if (*sarg == '[') sarg++;
+    if (sscanf(sarg, "%32[a-z]", reg) != 1) return false;
+    return parseIndexRegister(reg) != -1;
+}
+
+bool isFrameOperand(const char *sarg) {
+    assert(sarg);
+
+    return (strncmp(sarg, "[bp", 3) == 0) && !isalpha(sarg[3]);
+}
+
 char *concatenate(const char *str1, const char *str2) {
     assert(str1);
     assert(str2);
@@ -145,13 +205,67 @@ char *concatenate(const char *str1, const char *str2) {
     return concatenated;
 }
 
+/**
+ * Encodes integer immediate, decimal or hexadecimal with 0x prefix. Leading zeros do not mean octal.
+ */
 int processNumberArgument(char **machineCode, const char *sarg) {
     assert(machineCode);
     assert(*machineCode);
     assert(sarg);
 
-    int arg = atoi(sarg);
-    *((int *) (*machineCode)) = arg;
+    const char *digits = (*sarg == '-') ? sarg + 1 : sarg;
+    bool hex = (digits[0] == '0') && ((digits[1] == 'x') || (digits[1] == 'X'));
+    char *end = nullptr;
+    long long arg = strtoll(sarg, &end, hex ? 16 : 10);
+    if ((end == sarg) || (*end != '\0')) {
+        printf(ANSI_COLOR_RED "Invalid immediate %s. Terminating...\n" ANSI_COLOR_RESET, sarg);
+        return -1;
+    }
+    if ((arg < INT_MIN) || (arg > INT_MAX)) {
+        printf(ANSI_COLOR_RED "Immediate %s is out of range. Terminating...\n" ANSI_COLOR_RESET, sarg);
+        return -1;
+    }
+    *((int *) (*machineCode)) = (int) arg;
+    *machineCode = (char *) ((int *) (*machineCode) + 1);
+
+    return 0;
+}
+
+/**
+ * Encodes value immediate. Models with NUM_SCALED_IMMEDIATES get it pre-scaled and may have a fractional part.
+ */
+int processFixedArgument(char **machineCode, const char *sarg) {
+    assert(machineCode);
+    assert(*machineCode);
+    assert(sarg);
+
+    if (!NUM_SCALED_IMMEDIATES) {
+        // VM multiplies the immediate by NUM_ONE, which has to fit num_t. There is no encoding for fractions.
+        if (strchr(sarg, '.')) {
+            printf(ANSI_COLOR_RED "Fractional immediate %s is not supported by this numeric model. Terminating...\n" ANSI_COLOR_RESET, sarg);
+            return -1;
+        }
+        if (processNumberArgument(machineCode, sarg) == -1) return -1;
+        int arg = *((int *) *machineCode - 1);
+        if ((arg > NUM_MAX_INT) || (arg < -NUM_MAX_INT)) {
+            printf(ANSI_COLOR_RED "Immediate %s is out of range. Terminating...\n" ANSI_COLOR_RESET, sarg);
+            return -1;
+        }
+        return 0;
+    }
+
+    char *end = nullptr;
+    double value = strtod(sarg, &end) * NUM_ONE;
+    if ((end == sarg) || (*end != '\0')) {
+        printf(ANSI_COLOR_RED "Invalid immediate %s. Terminating...\n" ANSI_COLOR_RESET, sarg);
+        return -1;
+    }
+    // Written so that NaN is out of range as well
+    if (!((value >= INT_MIN) && (value <= INT_MAX))) {
+        printf(ANSI_COLOR_RED "Immediate %s is out of range. Terminating...\n" ANSI_COLOR_RESET, sarg);
+        return -1;
+    }
+    *((int *) (*machineCode)) = (int) lround(value);
     *machineCode = (char *) ((int *) (*machineCode) + 1);
 
     return 0;
@@ -173,7 +287,24 @@ int processRegisterArgument(char **machineCode, const char *sarg) {
     return 0;
 }
 
-int processMixedRAM(char **machineCode, const char *sarg) {
+int processIndexArgument(char **machineCode, const char *sarg) {
+    assert(machineCode);
+    assert(*machineCode);
+    assert(sarg);
+
+    int arg = parseIndexRegister(sarg);
+    if (arg == -1) {
+        printf(ANSI_COLOR_RED "Invalid index register name provided. Terminating...\n" ANSI_COLOR_RESET);
+        return -1;
+    }
+    *((int *) (*machineCode)) = arg;
+    *machineCode = (char *) ((int *) (*machineCode) + 1);
+
+    return 0;
+}
+
+int processMixedRAM(char **machineCode, const char *sarg,
+                    int (*processBase)(char **, const char *) = processRegisterArgument) {
     assert(machineCode);
     assert(*machineCode);
     assert(sarg);
@@ -186,20 +317,71 @@ int processMixedRAM(char **machineCode, const char *sarg) {
             printf(ANSI_COLOR_RED "Invalid RAM address declaration. Terminating..." ANSI_COLOR_RESET);
             return -1;
         }
-    } else if (sarg, '-') {
+    } else if (strchr(sarg, '-')) {
         if (sscanf(sarg, "[%[a-z]-%d]", ram_sarg, &arg) == EOF) {
             printf(ANSI_COLOR_RED "Invalid RAM address declaration. Terminating..." ANSI_COLOR_RESET);
             return -1;
         }
         arg *= -1;
-    } else {
+    } else if (sscanf(sarg, "[%[a-z]]", ram_sarg) != 1) {
         printf(ANSI_COLOR_RED"Invalid register + immediate RAM value. Terminating...\n" ANSI_COLOR_RESET);
         return -1;
     }
 
-    processRegisterArgument(machineCode, ram_sarg);
+    if (processBase(machineCode, ram_sarg) == -1)
+        return -1;
     *((int *) (*machineCode)) = arg;
     *machineCode = (char *) ((int *) (*machineCode) + 1);
+
+    return 0;
+}
+
+// Frame pointer is implicit in the instruction, only the offset is encoded
+int processFrameBase(char **machineCode, const char *sarg) {
+    assert(machineCode);
+    assert(sarg);
+
+    if (strcmp(sarg, "bp") != 0) {
+        printf(ANSI_COLOR_RED "Invalid frame pointer name provided. Terminating...\n" ANSI_COLOR_RESET);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Frame slots are addressed upwards from bp, the VM rejects cells below the frame
+int processFrameArgument(char **machineCode, const char *sarg) {
+    assert(machineCode);
+    assert(*machineCode);
+    assert(sarg);
+
+    if (processMixedRAM(machineCode, sarg, processFrameBase) == -1)
+        return -1;
+    if (*((int *) *machineCode - 1) < 0) {
+        printf(ANSI_COLOR_RED "Negative frame offset in %s, frame slots are addressed as [bp+k]. Terminating...\n" ANSI_COLOR_RESET, sarg);
+        return -1;
+    }
+
+    return 0;
+}
+
+int processPixelArgument(char **machineCode, const char *sarg) {
+    assert(machineCode);
+    assert(*machineCode);
+    assert(sarg);
+
+    int desc = atoi(sarg);
+    int x = desc / 10000;
+    int y = desc / 10 % 1000;
+    int color = desc % 10;
+    if ((desc < 0) || (x > PIXEL_X_MAX) || (y > PIXEL_Y_MAX)) {
+        printf(ANSI_COLOR_RED "Invalid pixel descriptor %s. Terminating...\n" ANSI_COLOR_RESET, sarg);
+        return -1;
+    }
+    *((int *) (*machineCode)) = (x << PIXEL_X_SHIFT) | (y << PIXEL_Y_SHIFT) | color;
+    *machineCode = (char *) ((int *) (*machineCode) + 1);
+
+    return 0;
 }
 
 int addLabel(label_t *labels, char *cmd, char *end, int len) {
@@ -237,67 +419,204 @@ int processLabel(char **machineCode, const label_t *labels, const char *sarg) {
     return -1;
 }
 
-char *
-defineCommandOverload(char **machine_code, int *len, int opcode, argumentTypes argtype, bool parseLabels, char *sarg,
-                      label_t *labels) {
+/**
+ * Emits jump table for the preceding switch: number of entries followed by label addresses
+ * @param line Source line, e.g. "table idle run stop"
+ * @return 0 if successful, -1 otherwise
+ */
+int processTable(char **machineCode, int *len, bool parseLabels, const char *line, label_t *labels) {
+    assert(machineCode);
+    assert(*machineCode);
+    assert(len);
+    assert(line);
+    assert(labels);
+
+    char label[MAX_SARG_SIZE] = "";
+    int offset = 0;
+    sscanf(line, " table%n", &offset);
+    line += offset;
+
+    int *count = (int *) (*machineCode);
+    *count = 0;
+    *machineCode = (char *) (count + 1);
+
+    while (sscanf(line, " %32s%n", label, &offset) == 1) {
+        line += offset;
+        if (!parseLabels && (processLabel(machineCode, labels, label) == -1))
+            return -1;
+        *machineCode = (char *) ((int *) (*machineCode) + 1);
+        (*count)++;
+    }
+    *len += (*count + 1) * sizeof(int);
+
+    return 0;
+}
+
+int processArgument(char **machine_code, int *len, argumentTypes argtype, bool parseLabels, const char *sarg,
+                    label_t *labels) {
     assert(machine_code);
     assert(*machine_code);
     assert(len);
+    assert(sarg);
 
     char ram_sarg[MAX_SARG_SIZE] = "";
-    int arg = 0;
-    int arg2 = 0;
+    int offset = 0;
 
-    **machine_code = opcode;
-    (*machine_code)++;
-    *len += sizeof(char);
     switch (argtype) {
         case NUMBER:
-            processNumberArgument(machine_code, sarg);
+            if (processNumberArgument(machine_code, sarg) == -1)
+                return -1;
             *len += sizeof(int);
             break;
         case REGISTER:
             if (processRegisterArgument(machine_code, sarg) == -1)
-                return nullptr;
+                return -1;
             *len += sizeof(int);
             break;
         case RAM_REG:
             if (sscanf(sarg, "[%[a-z]]", ram_sarg) != EOF) {
-                if (processRegisterArgument(machine_code, sarg) == -1)
-                    return nullptr;
+                if (processRegisterArgument(machine_code, ram_sarg) == -1)
+                    return -1;
                 *len += sizeof(int);
             } else {
                 printf(ANSI_COLOR_RED "Invalid RAM address declaration. Terminating..." ANSI_COLOR_RESET);
-                return nullptr;
+                return -1;
             }
             break;
         case RAM_IMMED:
-            if (sscanf(sarg, "[%d]", &arg) != EOF) {
-                processNumberArgument(machine_code, sarg);
+            // Closing bracket has to end the operand, the address between the brackets is checked as a number
+            if ((sscanf(sarg, "[%32[^]]]%n", ram_sarg, &offset) == 1) && (offset > 0) && (sarg[offset] == '\0')) {
+                if (processNumberArgument(machine_code, ram_sarg) == -1)
+                    return -1;
                 *len += sizeof(int);
             } else {
                 printf(ANSI_COLOR_RED "Invalid RAM address declaration. Terminating..." ANSI_COLOR_RESET);
-                return nullptr;
+                return -1;
             }
             break;
         case NONE:
             break;
         case RAM_REG_IMMED:
-            if (processMixedRAM(machine_code, sarg) == -1) return nullptr;
+            if (processMixedRAM(machine_code, sarg) == -1) return -1;
             *len += 2 * sizeof(int);
             break;
         case LABEL:
             if (!parseLabels) {
                 if (processLabel(machine_code, labels, sarg) == -1)
-                    return nullptr;
+                    return -1;
             } else {
                 *((int *) (*machine_code)) = 0;
             }
             (*machine_code) = (char *) ((int *) (*machine_code) + 1);
             *len += sizeof(int);
+            break;
+        case PIXEL:
+            if (processPixelArgument(machine_code, sarg) == -1)
+                return -1;
+            *len += sizeof(int);
+            break;
+        case INDEX:
+            if (processIndexArgument(machine_code, sarg) == -1)
+                return -1;
+            *len += sizeof(int);
+            break;
+        case RAM_INDEX:
+            if (sscanf(sarg, "[%[a-z]]", ram_sarg) != EOF) {
+                if (processIndexArgument(machine_code, ram_sarg) == -1)
+                    return -1;
+                *len += sizeof(int);
+            } else {
+                printf(ANSI_COLOR_RED "Invalid RAM address declaration. Terminating..." ANSI_COLOR_RESET);
+                return -1;
+            }
+            break;
+        case RAM_INDEX_IMMED:
+            if (processMixedRAM(machine_code, sarg, processIndexArgument) == -1) return -1;
+            *len += 2 * sizeof(int);
+            break;
+        case FIXED:
+            if (processFixedArgument(machine_code, sarg) == -1)
+                return -1;
+            *len += sizeof(int);
+            break;
+        case RAM_FRAME:
+            if (processFrameArgument(machine_code, sarg) == -1) return -1;
+            *len += sizeof(int);
+            break;
+        default:
+            printf(ANSI_COLOR_RED "Unsupported argument type %d. Terminating...\n" ANSI_COLOR_RESET, argtype);
+            return -1;
+    }
+
+    return 0;
+}
+
+char *
+defineCommandOverload(char **machine_code, int *len, int opcode, argumentTypes argtype, bool parseLabels, char *sarg,
+                      char *sarg2, label_t *labels) {
+    assert(machine_code);
+    assert(*machine_code);
+    assert(len);
+
+    **machine_code = opcode;
+    (*machine_code)++;
+    *len += sizeof(char);
+
+    int status = 0;
+    switch (argtype) {
+        case INDEX_REG:
+            status = processArgument(machine_code, len, INDEX, parseLabels, sarg, labels);
+            if (status != -1) status = processArgument(machine_code, len, REGISTER, parseLabels, sarg2, labels);
+            break;
+        case REG_INDEX:
+            status = processArgument(machine_code, len, REGISTER, parseLabels, sarg, labels);
+            if (status != -1) status = processArgument(machine_code, len, INDEX, parseLabels, sarg2, labels);
+            break;
+        case REG_REG:
+            status = processArgument(machine_code, len, REGISTER, parseLabels, sarg, labels);
+            if (status != -1) status = processArgument(machine_code, len, REGISTER, parseLabels, sarg2, labels);
+            break;
+        case REG_NUMBER:
+            status = processArgument(machine_code, len, REGISTER, parseLabels, sarg, labels);
+            if (status != -1) status = processArgument(machine_code, len, NUMBER, parseLabels, sarg2, labels);
+            break;
+        case REG_FIXED:
+            status = processArgument(machine_code, len, REGISTER, parseLabels, sarg, labels);
+            if (status != -1) status = processArgument(machine_code, len, FIXED, parseLabels, sarg2, labels);
+            break;
+        case NUMBER_NUMBER:
+            status = processArgument(machine_code, len, NUMBER, parseLabels, sarg, labels);
+            if (status != -1) status = processArgument(machine_code, len, NUMBER, parseLabels, sarg2, labels);
+            break;
+        case REG_LABEL:
+            status = processArgument(machine_code, len, REGISTER, parseLabels, sarg, labels);
+            if (status != -1) status = processArgument(machine_code, len, LABEL, parseLabels, sarg2, labels);
+            break;
+        case INDEX_LABEL:
+            status = processArgument(machine_code, len, INDEX, parseLabels, sarg, labels);
+            if (status != -1) status = processArgument(machine_code, len, LABEL, parseLabels, sarg2, labels);
+            break;
+        default:
+            status = processArgument(machine_code, len, argtype, parseLabels, sarg, labels);
     }
 
-    return (char *) 1;
+    return (status == -1) ? nullptr : (char *) 1;
+}
+
+/**
+ * Splits source line into command and up to two comma-separated operands, e.g. "ldx ai, ax"
+ */
+void splitOperands(const char *line, char *cmd, char *sarg, char *sarg2) {
+    assert(line);
+    assert(cmd);
+    assert(sarg);
+    assert(sarg2);
+
+    sscanf(line, "%32s %32[^,\n] , %32s", cmd, sarg, sarg2);
+
+    char *end = sarg + strlen(sarg);
+    while ((end > sarg) && isspace(*(end - 1)))
+        *--end = '\0';
 }
 
 label_t *findLabel(label_t *labels, char *name) {
@@ -318,8 +637,9 @@ char *generateMachineCode(FILE *sourceFile, int lines, int *fileSize, label_t *l
     assert(sourceFile);
     assert(fileSize);
 
-    auto machine_code = (char *) calloc(sizeof(char) + MAX_ARGS_NUM * sizeof(int),
-                                        lines);
+    // Jump tables emit one address per label, which takes at least two characters of the source
+    auto machine_code = (char *) calloc(lines * (sizeof(char) + MAX_ARGS_NUM * sizeof(int)) +
+                                        ::fileSize(sourceFile) / 2 * sizeof(int), sizeof(char));
 
     bool parseLabels = false;
     if (!labels) {
@@ -329,25 +649,32 @@ char *generateMachineCode(FILE *sourceFile, int lines, int *fileSize, label_t *l
 
     char *machine_code_start = machine_code;
 
+    // Lines are read whole, so jump tables may list any number of labels
+    char *line = nullptr;
+    size_t lineSize = 0;
     char cmd[MAX_CMD_SIZE] = "";
     char sarg[MAX_SARG_SIZE] = "";
+    char sarg2[MAX_SARG_SIZE] = "";
 
     int len = 0;
 
     for (int i = 0; i < lines; i++) {
-        if (fscanf(sourceFile, "%s", cmd) == 0) break;
+        if (getline(&line, &lineSize, sourceFile) == -1) break;
+        splitOperands(line, cmd, sarg, sarg2);
 
 #define CMD_OVRLD(opcode, cond, argtype, execcode) \
-        if (cond) defineCommandOverload(&machine_code, &len, opcode, argtype, parseLabels, sarg, labels); \
+        if (cond) { \
+            if (!defineCommandOverload(&machine_code, &len, opcode, argtype, parseLabels, sarg, sarg2, labels)) \
+                return nullptr; \
+        } \
         else
 
 #define DEF_CMD(name, args, overloaders) \
     if(strcmp(cmd, #name) == 0) {\
-        if(args) \
-            if(!fscanf(sourceFile, "%s", sarg)) {\
-            printf(ANSI_COLOR_RED "Invalid number of arguments!\n" ANSI_COLOR_RESET);\
+        if(((args >= 1) && !*sarg) || ((args >= 2) && !*sarg2)) {\
+            printf(ANSI_COLOR_RED "Invalid number of arguments for command %s in line %d!\n" ANSI_COLOR_RESET, cmd, i + 1);\
             return nullptr;\
-         } \
+        } \
         overloaders \
         {\
             printf(ANSI_COLOR_RED "Invalid argument parameter %s for command %s in line %d. Terminating...\n" ANSI_COLOR_RESET, sarg, cmd, i + 1); \
@@ -357,7 +684,11 @@ char *generateMachineCode(FILE *sourceFile, int lines, int *fileSize, label_t *l
     else
 
 #include "../commands.h"
-        {
+        if (strcmp(cmd, "table") == 0) {
+            if (processTable(&machine_code, &len, parseLabels, line, labels) == -1)
+                return nullptr;
+        }
+        else {
             char *end = strchr(cmd, ':');
             if (end && parseLabels)
                 if (!addLabel(labels, cmd, end, len))
@@ -367,11 +698,13 @@ char *generateMachineCode(FILE *sourceFile, int lines, int *fileSize, label_t *l
 #undef DEF_CMD
 #undef CMD_OVRLD
 
-        fscanf(sourceFile, "\n");
         memset(sarg, 0, MAX_SARG_SIZE);
+        memset(sarg2, 0, MAX_SARG_SIZE);
         memset(cmd, 0, MAX_CMD_SIZE);
     }
 
+    free(line);
+
     *fileSize = sizeof(char) * len;
     machine_code = (char *) realloc(machine_code_start, *fileSize);
     rewind(sourceFile);
@@ -0,0 +1,42 @@
+#include "bus.h"
+#include <assert.h>
+
+void busConstruct(bus_t *bus) {
+    assert(bus);
+
+    for (size_t slot = 0; slot < BUS_SLOTS_NUM; slot++)
+        bus->slots[slot] = {};
+}
+
+/**
+ * Maps device at MMIO_BASE + slot * BUS_SLOT_SIZE
+ * @param bus Pointer to bus
+ * @param slot Slot number
+ * @param device Device descriptor, copied into the bus
+ * @return 1 if successful, 0 if the slot does not exist or is taken
+ */
+int busAttach(bus_t *bus, size_t slot, const device_t *device) {
+    assert(bus);
+    assert(device);
+
+    if ((slot >= BUS_SLOTS_NUM) || bus->slots[slot].name) return 0;
+    bus->slots[slot] = *device;
+    return 1;
+}
+
+/**
+ * Resolves address in the device window
+ * @param bus Pointer to bus
+ * @param address Address of the access
+ * @param offset Register number inside the device
+ * @return Device or nullptr if nothing is mapped at the address
+ */
+const device_t *busFind(const bus_t *bus, long long address, size_t *offset) {
+    assert(bus);
+    assert(offset);
+
+    if ((address < MMIO_BASE) || (address >= 0)) return nullptr;
+    const device_t *device = bus->slots + (address - MMIO_BASE) / BUS_SLOT_SIZE;
+    *offset = (address - MMIO_BASE) % BUS_SLOT_SIZE;
+    return device->name ? device : nullptr;
+}
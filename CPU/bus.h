@@ -0,0 +1,40 @@
+#include <stdlib.h>
+#include "../numeric.h"
+
+#ifndef CPU_BUS_H
+#define CPU_BUS_H
+
+// Devices are mapped into a window of negative addresses just below 0, which RAM never uses.
+// It is small enough for addresses computed in registers of every numeric model, including Q16.
+// Each device gets one BUS_SLOT_SIZE page, so dispatch is an index into the slot table.
+const size_t BUS_SLOT_SIZE = 256;
+
+const size_t BUS_SLOTS_NUM = 16;
+
+const long long MMIO_BASE = -(long long) (BUS_SLOTS_NUM * BUS_SLOT_SIZE);
+
+typedef num_t (*device_read_t)(void *context, size_t offset);
+
+typedef void (*device_write_t)(void *context, size_t offset, num_t value);
+
+/**
+ * Memory-mapped device. Reads of write-only registers give 0, writes to read-only ones are ignored.
+ */
+struct device_t {
+    const char *name;
+    void *context;
+    device_read_t read;
+    device_write_t write;
+};
+
+struct bus_t {
+    device_t slots[BUS_SLOTS_NUM];
+};
+
+void busConstruct(bus_t *bus);
+
+int busAttach(bus_t *bus, size_t slot, const device_t *device);
+
+const device_t *busFind(const bus_t *bus, long long address, size_t *offset);
+
+#endif //CPU_BUS_H
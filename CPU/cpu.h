@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include "stack.h"
+#include "ram.h"
+
+#ifndef CPU_CPU_H
+#define CPU_CPU_H
+
+const size_t WIDTH = 64;
+
+const size_t HEIGHT = 64;
+
+const size_t TILE_SIZE = 8;
+
+const size_t SPRITE_ATTRS_NUM = 4;
+
+const size_t MAX_SPRITES = 64;
+
+const int REGS_NUM = 16;
+
+const int INDEX_REGS_NUM = 4;
+
+const int CALL_STACK_DEPTH = 1024;
+
+const int FRAME_REGION_SIZE = 16384;
+
+const int FLAG_ZERO = 1;
+
+const int FLAG_LESS = 2;
+
+// Tiles are TILE_SIZE x TILE_SIZE blocks of colors in RAM, negative color is transparent.
+// Tile map holds one tile index per cell, sprite table is a count followed by (x, y, tile, reserved) records.
+// Negative address disables the corresponding layer.
+struct display_t {
+    int tileset;
+    int tilemap;
+    int sprites;
+};
+
+/**
+ * Machine state that is saved to and restored from snapshots
+ */
+struct cpu_t {
+    num_t registers[REGS_NUM];
+    int indexes[INDEX_REGS_NUM];
+    int flags;
+    int calls[CALL_STACK_DEPTH];
+    int callDepth;
+    num_t frames[FRAME_REGION_SIZE];
+    int bp;
+    int frameTop;
+    stack_t stk;
+    ram_t ram;
+    char *VRAM;
+    display_t display;
+};
+
+inline int compareFlags(num_t a, num_t b) {
+    return ((a == b) ? FLAG_ZERO : 0) | ((a < b) ? FLAG_LESS : 0);
+}
+
+#endif //CPU_CPU_H
@@ -0,0 +1,108 @@
+#include "dma.h"
+#include <assert.h>
+#include <string.h>
+
+static void dmaTransfer(const dma_job_t *job) {
+    assert(job);
+
+    switch (job->type) {
+        case DMA_COPY:
+            memmove(job->to, job->from, job->count * sizeof(num_t));
+            break;
+        case DMA_FILL:
+            for (size_t i = 0; i < job->count; i++)
+                job->to[i] = job->value;
+            break;
+        case DMA_BLIT:
+            for (size_t i = 0; i < job->count; i++)
+                job->vram[i] = (char) numToInt(job->from[i]);
+            break;
+    }
+}
+
+static void dmaWorker(dma_t *dma) {
+    assert(dma);
+
+    std::unique_lock<std::mutex> guard(dma->lock);
+    while (true) {
+        dma->queued.wait(guard, [dma] { return dma->stopping || (dma->head != dma->tail); });
+        if (dma->head == dma->tail) return;
+
+        dma_job_t job = dma->queue[dma->head % DMA_QUEUE_SIZE];
+        guard.unlock();
+        dmaTransfer(&job);
+        guard.lock();
+
+        dma->head++;
+        dma->completed.store(dma->completed.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        dma->done.notify_all();
+    }
+}
+
+/**
+ * Initializes DMA controller. Worker thread is started on the first transfer.
+ * @param dma Pointer to controller
+ */
+void dmaConstruct(dma_t *dma) {
+    assert(dma);
+
+    dma->head = 0;
+    dma->tail = 0;
+    dma->stopping = false;
+    dma->submitted = 0;
+    dma->completed.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * Queues transfer, blocks only if the queue is full
+ * @param dma Pointer to controller
+ * @param job Transfer descriptor
+ */
+void dmaSubmit(dma_t *dma, const dma_job_t *job) {
+    assert(dma);
+    assert(job);
+
+    std::unique_lock<std::mutex> guard(dma->lock);
+    if (!dma->worker.joinable())
+        dma->worker = std::thread(dmaWorker, dma);
+
+    dma->done.wait(guard, [dma] { return dma->tail - dma->head < DMA_QUEUE_SIZE; });
+    dma->queue[dma->tail++ % DMA_QUEUE_SIZE] = *job;
+    dma->submitted++;
+    dma->queued.notify_one();
+}
+
+/**
+ * Completion flag: acquire load pairs with the worker's release, so finished transfers are visible to the VM
+ * @param dma Pointer to controller
+ * @return true if all queued transfers have finished
+ */
+bool dmaIdle(dma_t *dma) {
+    assert(dma);
+
+    return dma->completed.load(std::memory_order_acquire) == dma->submitted;
+}
+
+void dmaWait(dma_t *dma) {
+    assert(dma);
+
+    if (dmaIdle(dma)) return;
+    std::unique_lock<std::mutex> guard(dma->lock);
+    dma->done.wait(guard, [dma] { return dmaIdle(dma); });
+}
+
+/**
+ * Finishes queued transfers and stops worker thread
+ * @param dma Pointer to controller
+ */
+void dmaDestruct(dma_t *dma) {
+    assert(dma);
+
+    if (!dma->worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(dma->lock);
+        dma->stopping = true;
+        dma->queued.notify_one();
+    }
+    dma->worker.join();
+}
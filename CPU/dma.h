@@ -0,0 +1,56 @@
+#include <stdlib.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "../numeric.h"
+
+#ifndef CPU_DMA_H
+#define CPU_DMA_H
+
+const size_t DMA_QUEUE_SIZE = 16;
+
+enum dmaTypes {
+    DMA_COPY,
+    DMA_FILL,
+    DMA_BLIT
+};
+
+/**
+ * Transfer descriptor. Addresses are resolved and bounds-checked by the VM before the descriptor is queued.
+ */
+struct dma_job_t {
+    dmaTypes type;
+    num_t *to;
+    char *vram;
+    const num_t *from;
+    num_t value;
+    size_t count;
+};
+
+struct dma_t {
+    dma_job_t queue[DMA_QUEUE_SIZE];
+    size_t head;
+    size_t tail;
+    bool stopping;
+
+    unsigned long submitted;
+    std::atomic<unsigned long> completed;
+
+    std::mutex lock;
+    std::condition_variable queued;
+    std::condition_variable done;
+    std::thread worker;
+};
+
+void dmaConstruct(dma_t *dma);
+
+void dmaSubmit(dma_t *dma, const dma_job_t *job);
+
+bool dmaIdle(dma_t *dma);
+
+void dmaWait(dma_t *dma);
+
+void dmaDestruct(dma_t *dma);
+
+#endif //CPU_DMA_H
@@ -0,0 +1,220 @@
+#include "framebuffer.h"
+#include <assert.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+
+/**
+ * Creates shared memory segment with VRAM copy for external viewers
+ * @param fb Pointer to framebuffer
+ * @param name POSIX shared memory object name, e.g. "/cpu"
+ * @param width Screen width
+ * @param height Screen height
+ * @param notify Whether eventfd should be signalled on every published frame
+ * @return 1 if successful, 0 otherwise
+ */
+int framebufferCreate(framebuffer_t *fb, const char *name, size_t width, size_t height, bool notify) {
+    assert(fb);
+    assert(name);
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd == -1) return 0;
+
+    fb->size = sizeof(framebuffer_header_t) + width * height;
+    if (ftruncate(fd, fb->size) == -1) {
+        close(fd);
+        return 0;
+    }
+
+    void *segment = mmap(nullptr, fb->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) return 0;
+
+    fb->header = (framebuffer_header_t *) segment;
+    fb->pixels = (char *) segment + sizeof(framebuffer_header_t);
+    fb->name = strdup(name);
+    fb->eventFd = notify ? eventfd(0, EFD_NONBLOCK) : -1;
+
+    fb->header->magic = FRAMEBUFFER_MAGIC;
+    fb->header->width = width;
+    fb->header->height = height;
+    fb->header->pid = getpid();
+    fb->header->eventFd = fb->eventFd;
+    fb->header->sequence.store(0, std::memory_order_relaxed);
+    fb->header->alive.store(1, std::memory_order_release);
+
+    return 1;
+}
+
+/**
+ * Copies VRAM into the segment under the seqlock and notifies eventfd
+ * @param fb Pointer to framebuffer
+ * @param VRAM Frame to publish
+ */
+void framebufferPublish(framebuffer_t *fb, const char *VRAM) {
+    assert(fb);
+    assert(fb->header);
+    assert(VRAM);
+
+    unsigned long long sequence = fb->header->sequence.load(std::memory_order_relaxed);
+    fb->header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(fb->pixels, VRAM, fb->header->width * fb->header->height);
+    fb->header->sequence.store(sequence + 2, std::memory_order_release);
+
+    if (fb->eventFd != -1) {
+        eventfd_write(fb->eventFd, 1);
+    }
+}
+
+/**
+ * Marks segment as finished, unmaps and removes it. Viewers that have it mapped keep the last frame.
+ * @param fb Pointer to framebuffer
+ */
+void framebufferDestroy(framebuffer_t *fb) {
+    assert(fb);
+
+    if (!fb->header) return;
+    fb->header->alive.store(0, std::memory_order_release);
+    if (fb->eventFd != -1) {
+        eventfd_write(fb->eventFd, 1);
+        close(fb->eventFd);
+    }
+    munmap(fb->header, fb->size);
+    shm_unlink(fb->name);
+    free(fb->name);
+    fb->header = nullptr;
+}
+
+/**
+ * Maps framebuffer published by another process read-only.
+ * eventfd is duplicated from the VM with pidfd_getfd where available, otherwise viewer has to poll.
+ * @param fb Pointer to framebuffer
+ * @param name POSIX shared memory object name
+ * @return 1 if successful, 0 otherwise
+ */
+int framebufferOpen(framebuffer_t *fb, const char *name) {
+    assert(fb);
+    assert(name);
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) return 0;
+
+    struct stat info = {};
+    if ((fstat(fd, &info) == -1) || ((size_t) info.st_size < sizeof(framebuffer_header_t))) {
+        close(fd);
+        return 0;
+    }
+
+    void *segment = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) return 0;
+
+    fb->header = (framebuffer_header_t *) segment;
+    fb->pixels = (char *) segment + sizeof(framebuffer_header_t);
+    fb->size = info.st_size;
+    fb->name = nullptr;
+    fb->eventFd = -1;
+
+    if ((fb->header->magic != FRAMEBUFFER_MAGIC) ||
+        (sizeof(framebuffer_header_t) + fb->header->width * fb->header->height > fb->size)) {
+        framebufferClose(fb);
+        return 0;
+    }
+
+#if defined(SYS_pidfd_open) && defined(SYS_pidfd_getfd)
+    if (fb->header->eventFd != -1) {
+        int pidFd = syscall(SYS_pidfd_open, fb->header->pid, 0);
+        if (pidFd != -1) {
+            fb->eventFd = syscall(SYS_pidfd_getfd, pidFd, fb->header->eventFd, 0);
+            close(pidFd);
+        }
+    }
+#endif
+
+    return 1;
+}
+
+/**
+ * Reads consistent copy of the latest frame. Gives up after FRAMEBUFFER_READ_RETRIES attempts,
+ * so a VM that died in the middle of publishing does not keep the reader spinning.
+ * @param fb Pointer to framebuffer
+ * @param frame Destination of width * height bytes
+ * @param sequence Sequence number of previously read frame, updated on success
+ * @return 1 if new frame was read, 0 if there was no new consistent frame
+ */
+int framebufferRead(framebuffer_t *fb, char *frame, unsigned long long *sequence) {
+    assert(fb);
+    assert(fb->header);
+    assert(frame);
+    assert(sequence);
+
+    for (int attempt = 0; attempt < FRAMEBUFFER_READ_RETRIES; attempt++) {
+        unsigned long long before = fb->header->sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            sched_yield();
+            continue;
+        }
+        if (before == *sequence) return 0;
+
+        memcpy(frame, fb->pixels, fb->header->width * fb->header->height);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (fb->header->sequence.load(std::memory_order_relaxed) == before) {
+            *sequence = before;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Waits for the next frame notification
+ * @param fb Pointer to framebuffer
+ * @param timeout Timeout in milliseconds
+ * @return 1 if VM signalled a frame, 0 on timeout or if notifications are unavailable
+ */
+int framebufferWait(framebuffer_t *fb, int timeout) {
+    assert(fb);
+
+    if (fb->eventFd == -1) {
+        usleep(timeout * 1000);
+        return 0;
+    }
+
+    pollfd event = {fb->eventFd, POLLIN, 0};
+    if (poll(&event, 1, timeout) <= 0) return 0;
+
+    eventfd_t counter = 0;
+    eventfd_read(fb->eventFd, &counter);
+    return 1;
+}
+
+/**
+ * Checks whether the VM still publishes frames
+ * @param fb Pointer to framebuffer
+ * @return 0 if the VM has finished or its process is gone, 1 otherwise
+ */
+int framebufferAlive(framebuffer_t *fb) {
+    assert(fb);
+    assert(fb->header);
+
+    if (!fb->header->alive.load(std::memory_order_acquire)) return 0;
+    return (kill(fb->header->pid, 0) == 0) || (errno == EPERM);
+}
+
+void framebufferClose(framebuffer_t *fb) {
+    assert(fb);
+
+    if (fb->eventFd != -1) close(fb->eventFd);
+    munmap(fb->header, fb->size);
+    fb->header = nullptr;
+}
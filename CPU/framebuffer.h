@@ -0,0 +1,50 @@
+#include <stdlib.h>
+#include <atomic>
+
+#ifndef CPU_FRAMEBUFFER_H
+#define CPU_FRAMEBUFFER_H
+
+const unsigned int FRAMEBUFFER_MAGIC = 0x56524D46; // "FMRV"
+
+// Attempts to read a frame that is being written before the reader gives up until the next wait
+const int FRAMEBUFFER_READ_RETRIES = 64;
+
+/**
+ * Header at the beginning of the shared memory segment, pixels follow it.
+ * sequence is a seqlock: it is odd while the VM copies a frame and even once the frame is complete.
+ */
+struct framebuffer_header_t {
+    unsigned int magic;
+    unsigned int width;
+    unsigned int height;
+    int pid;
+    int eventFd;
+    std::atomic<int> alive;
+    std::atomic<unsigned long long> sequence;
+};
+
+struct framebuffer_t {
+    framebuffer_header_t *header;
+    char *pixels;
+    size_t size;
+    char *name;
+    int eventFd;
+};
+
+int framebufferCreate(framebuffer_t *fb, const char *name, size_t width, size_t height, bool notify);
+
+void framebufferPublish(framebuffer_t *fb, const char *VRAM);
+
+void framebufferDestroy(framebuffer_t *fb);
+
+int framebufferOpen(framebuffer_t *fb, const char *name);
+
+int framebufferRead(framebuffer_t *fb, char *frame, unsigned long long *sequence);
+
+int framebufferWait(framebuffer_t *fb, int timeout);
+
+int framebufferAlive(framebuffer_t *fb);
+
+void framebufferClose(framebuffer_t *fb);
+
+#endif //CPU_FRAMEBUFFER_H
@@ -0,0 +1,192 @@
+#include "irq.h"
+#include <assert.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+typedef std::chrono::steady_clock irq_clock;
+
+static void irqRaise(irq_t *irq, int line) {
+    irq->pending.fetch_or(1u << line, std::memory_order_relaxed);
+    irq->changed.notify_all();
+}
+
+// Missed ticks are dropped instead of being delivered in a burst
+static bool irqTick(irq_clock::time_point *next, irq_clock::duration period, irq_clock::time_point now) {
+    if (now < *next) return false;
+    *next += period;
+    if (*next <= now) *next = now + period;
+    return true;
+}
+
+static void irqClock(irq_t *irq) {
+    assert(irq);
+
+    const irq_clock::duration vblankPeriod = std::chrono::microseconds(1000000 / VBLANK_HZ);
+    std::unique_lock<std::mutex> guard(irq->lock);
+    while (!irq->stopping) {
+        irq_clock::time_point next = irq_clock::time_point::max();
+        if (irq->timerPeriod.count()) next = irq->timerNext;
+        if (irq->vblankActive && (irq->vblankNext < next)) next = irq->vblankNext;
+
+        if (next == irq_clock::time_point::max())
+            irq->changed.wait(guard);
+        else
+            irq->changed.wait_until(guard, next);
+
+        irq_clock::time_point now = irq_clock::now();
+        if (irq->timerPeriod.count() && irqTick(&irq->timerNext, irq->timerPeriod, now))
+            irqRaise(irq, IRQ_TIMER);
+        if (irq->vblankActive && irqTick(&irq->vblankNext, vblankPeriod, now))
+            irqRaise(irq, IRQ_VBLANK);
+    }
+}
+
+// Raises input line when stdin becomes readable and waits until the VM reads it before watching again
+static void irqInput(irq_t *irq) {
+    assert(irq);
+
+    pollfd events[] = {{STDIN_FILENO, POLLIN, 0}, {irq->stopFd, POLLIN, 0}};
+    while (true) {
+        if (poll(events, 2, -1) == -1) continue;
+        if (events[1].revents) return;
+
+        std::unique_lock<std::mutex> guard(irq->lock);
+        if (irq->inputExternal) return;
+        irq->inputArmed = false;
+        irqRaise(irq, IRQ_INPUT);
+        irq->changed.wait(guard, [irq] { return irq->inputArmed || irq->stopping || irq->inputExternal; });
+        if (irq->stopping || irq->inputExternal) return;
+    }
+}
+
+void irqConstruct(irq_t *irq) {
+    assert(irq);
+
+    irq->pending.store(0, std::memory_order_relaxed);
+    irq->enabled = false;
+    irq->vectors = -1;
+    irq->timerPeriod = irq_clock::duration::zero();
+    irq->vblankActive = false;
+    irq->inputArmed = true;
+    irq->inputExternal = false;
+    irq->stopFd = -1;
+    irq->stopping = false;
+}
+
+/**
+ * Sets vector table address and starts device threads on first use
+ * @param irq Pointer to controller
+ * @param vectors RAM address of IRQ_LINES_NUM handler addresses, negative disables delivery
+ * @return 1 if successful, 0 otherwise
+ */
+int irqStart(irq_t *irq, int vectors) {
+    assert(irq);
+
+    irq->vectors = vectors;
+    if ((vectors < 0) || irq->clock.joinable()) return 1;
+
+    irq->stopFd = eventfd(0, 0);
+    if (irq->stopFd == -1) return 0;
+    irq->clock = std::thread(irqClock, irq);
+    irq->input = std::thread(irqInput, irq);
+    return 1;
+}
+
+/**
+ * Programs interval timer
+ * @param irq Pointer to controller
+ * @param period Period in milliseconds, 0 stops the timer
+ */
+void irqSetTimer(irq_t *irq, int period) {
+    assert(irq);
+
+    std::lock_guard<std::mutex> guard(irq->lock);
+    irq->timerPeriod = std::chrono::milliseconds(period > 0 ? period : 0);
+    irq->timerNext = irq_clock::now() + irq->timerPeriod;
+    irq->changed.notify_all();
+}
+
+// Display refresh starts with the first drawn frame
+void irqStartVBlank(irq_t *irq) {
+    assert(irq);
+
+    if (irq->vblankActive) return;
+    std::lock_guard<std::mutex> guard(irq->lock);
+    irq->vblankActive = true;
+    irq->vblankNext = irq_clock::now();
+    irq->changed.notify_all();
+}
+
+// Input has been read, the next readable state raises the line again
+void irqRearmInput(irq_t *irq) {
+    assert(irq);
+
+    std::lock_guard<std::mutex> guard(irq->lock);
+    irq->inputArmed = true;
+    irq->changed.notify_all();
+}
+
+// Input device reads stdin from now on and raises the input line itself
+void irqTakeInput(irq_t *irq) {
+    assert(irq);
+
+    std::lock_guard<std::mutex> guard(irq->lock);
+    irq->inputExternal = true;
+    irq->changed.notify_all();
+}
+
+// Raises line from a device thread
+void irqSignal(irq_t *irq, int line) {
+    assert(irq);
+    assert((line >= 0) && (line < IRQ_LINES_NUM));
+
+    std::lock_guard<std::mutex> guard(irq->lock);
+    irqRaise(irq, line);
+}
+
+/**
+ * Acknowledges highest priority pending line. Pending lines without a handler are dropped.
+ * @param irq Pointer to controller
+ * @param handled Mask of lines that have handlers
+ * @return Line number or -1 if nothing has to be delivered
+ */
+int irqNext(irq_t *irq, unsigned int handled) {
+    assert(irq);
+
+    unsigned int pending = irq->pending.exchange(0, std::memory_order_acquire);
+    unsigned int deliverable = pending & handled;
+    if (!deliverable) return -1;
+
+    int line = __builtin_ctz(deliverable);
+    irq->pending.fetch_or(deliverable & ~(1u << line), std::memory_order_relaxed);
+    return line;
+}
+
+/**
+ * Sleeps until one of the handled lines is raised
+ * @param irq Pointer to controller
+ * @param handled Mask of lines that have handlers
+ */
+void irqWait(irq_t *irq, unsigned int handled) {
+    assert(irq);
+
+    if (irq->pending.load(std::memory_order_relaxed) & handled) return;
+    std::unique_lock<std::mutex> guard(irq->lock);
+    irq->changed.wait(guard, [irq, handled] { return (irq->pending.load(std::memory_order_relaxed) & handled) != 0; });
+}
+
+void irqDestruct(irq_t *irq) {
+    assert(irq);
+
+    if (!irq->clock.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(irq->lock);
+        irq->stopping = true;
+        irq->changed.notify_all();
+    }
+    eventfd_write(irq->stopFd, 1);
+    irq->clock.join();
+    irq->input.join();
+    close(irq->stopFd);
+}
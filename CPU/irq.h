@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifndef CPU_IRQ_H
+#define CPU_IRQ_H
+
+// Interrupt lines in priority order. Vector table in RAM holds a handler address per line, 0 means no handler.
+enum irqLines {
+    IRQ_TIMER,
+    IRQ_VBLANK,
+    IRQ_INPUT,
+    IRQ_LINES_NUM
+};
+
+const int VBLANK_HZ = 60;
+
+/**
+ * Interrupt controller. Device threads raise lines by setting pending bits, the VM delivers them between instructions.
+ * Clock thread drives the interval timer and vblank, input thread watches stdin until an input device takes it over.
+ * Threads are started when the vector table is set, so programs without interrupts do not pay for them.
+ */
+struct irq_t {
+    std::atomic<unsigned int> pending;
+    bool enabled;
+    int vectors;
+
+    std::chrono::steady_clock::duration timerPeriod;
+    std::chrono::steady_clock::time_point timerNext;
+    bool vblankActive;
+    std::chrono::steady_clock::time_point vblankNext;
+    bool inputArmed;
+    bool inputExternal;
+    int stopFd;
+    bool stopping;
+
+    std::mutex lock;
+    std::condition_variable changed;
+    std::thread clock;
+    std::thread input;
+};
+
+void irqConstruct(irq_t *irq);
+
+int irqStart(irq_t *irq, int vectors);
+
+void irqSetTimer(irq_t *irq, int period);
+
+void irqStartVBlank(irq_t *irq);
+
+void irqRearmInput(irq_t *irq);
+
+void irqTakeInput(irq_t *irq);
+
+void irqSignal(irq_t *irq, int line);
+
+int irqNext(irq_t *irq, unsigned int handled);
+
+void irqWait(irq_t *irq, unsigned int handled);
+
+void irqDestruct(irq_t *irq);
+
+#endif //CPU_IRQ_H
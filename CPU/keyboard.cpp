@@ -0,0 +1,128 @@
+#include "keyboard.h"
+#include <assert.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+// Terminal settings are restored on any exit path, including errors that call exit() and fatal signals
+static termios savedTerminal = {};
+
+static bool terminalRaw = false;
+
+static void restoreTerminal() {
+    if (!terminalRaw) return;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &savedTerminal);
+    terminalRaw = false;
+}
+
+static void restoreTerminalOnSignal(int signal) {
+    restoreTerminal();
+    ::signal(signal, SIG_DFL);
+    raise(signal);
+}
+
+// Keys are delivered one by one without echo, Ctrl-C still interrupts the VM
+static void enterRawMode() {
+    if (!isatty(STDIN_FILENO) || (tcgetattr(STDIN_FILENO, &savedTerminal) == -1)) return;
+
+    termios raw = savedTerminal;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_iflag &= ~(IXON | ICRNL);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1) return;
+
+    terminalRaw = true;
+    atexit(restoreTerminal);
+    signal(SIGINT, restoreTerminalOnSignal);
+    signal(SIGTERM, restoreTerminalOnSignal);
+}
+
+// Keys that do not fit into the buffer are dropped
+static void keyboardPut(keyboard_t *keyboard, unsigned char key) {
+    size_t tail = keyboard->tail.load(std::memory_order_relaxed);
+    if (tail - keyboard->head.load(std::memory_order_acquire) == KEYBOARD_BUFFER_SIZE) return;
+    keyboard->buffer[tail % KEYBOARD_BUFFER_SIZE] = key;
+    keyboard->tail.store(tail + 1, std::memory_order_release);
+}
+
+static void keyboardReader(keyboard_t *keyboard) {
+    assert(keyboard);
+
+    pollfd events[] = {{STDIN_FILENO, POLLIN, 0}, {keyboard->stopFd, POLLIN, 0}};
+    unsigned char keys[KEYBOARD_BUFFER_SIZE] = {};
+    while (true) {
+        if (poll(events, 2, -1) == -1) continue;
+        if (events[1].revents) return;
+
+        ssize_t count = read(STDIN_FILENO, keys, sizeof(keys));
+        if (count <= 0) return;
+        for (ssize_t i = 0; i < count; i++)
+            keyboardPut(keyboard, keys[i]);
+        irqSignal(keyboard->irq, IRQ_INPUT);
+    }
+}
+
+void keyboardConstruct(keyboard_t *keyboard, irq_t *irq) {
+    assert(keyboard);
+    assert(irq);
+
+    keyboard->head.store(0, std::memory_order_relaxed);
+    keyboard->tail.store(0, std::memory_order_relaxed);
+    keyboard->started = false;
+    keyboard->stopFd = -1;
+    keyboard->irq = irq;
+}
+
+/**
+ * Switches terminal to raw mode and starts reader thread, does nothing if the device is already running.
+ * Input interrupt is raised by the device from now on, so "in" should not be mixed with key reads.
+ * @param keyboard Pointer to device
+ * @return 1 if successful, 0 otherwise
+ */
+int keyboardStart(keyboard_t *keyboard) {
+    assert(keyboard);
+
+    if (keyboard->started) return 1;
+    keyboard->stopFd = eventfd(0, 0);
+    if (keyboard->stopFd == -1) return 0;
+
+    enterRawMode();
+    irqTakeInput(keyboard->irq);
+    keyboard->reader = std::thread(keyboardReader, keyboard);
+    keyboard->started = true;
+    return 1;
+}
+
+/**
+ * Takes next key without blocking
+ * @param keyboard Pointer to device
+ * @return Key code or -1 if no key has been pressed
+ */
+int keyboardRead(keyboard_t *keyboard) {
+    assert(keyboard);
+
+    size_t head = keyboard->head.load(std::memory_order_relaxed);
+    if (head == keyboard->tail.load(std::memory_order_acquire)) return -1;
+    int key = keyboard->buffer[head % KEYBOARD_BUFFER_SIZE];
+    keyboard->head.store(head + 1, std::memory_order_release);
+    return key;
+}
+
+size_t keyboardReady(keyboard_t *keyboard) {
+    assert(keyboard);
+
+    return keyboard->tail.load(std::memory_order_acquire) - keyboard->head.load(std::memory_order_relaxed);
+}
+
+void keyboardDestruct(keyboard_t *keyboard) {
+    assert(keyboard);
+
+    if (!keyboard->started) return;
+    eventfd_write(keyboard->stopFd, 1);
+    keyboard->reader.join();
+    close(keyboard->stopFd);
+    restoreTerminal();
+    keyboard->started = false;
+}
@@ -0,0 +1,37 @@
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <termios.h>
+#include "irq.h"
+
+#ifndef CPU_KEYBOARD_H
+#define CPU_KEYBOARD_H
+
+const size_t KEYBOARD_BUFFER_SIZE = 256;
+
+/**
+ * Keyboard device. Reader thread puts key codes into a single-producer single-consumer ring buffer,
+ * the VM takes them without blocking. Terminal is switched to raw mode while the device is running.
+ */
+struct keyboard_t {
+    unsigned char buffer[KEYBOARD_BUFFER_SIZE];
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+
+    bool started;
+    int stopFd;
+    irq_t *irq;
+    std::thread reader;
+};
+
+void keyboardConstruct(keyboard_t *keyboard, irq_t *irq);
+
+int keyboardStart(keyboard_t *keyboard);
+
+int keyboardRead(keyboard_t *keyboard);
+
+size_t keyboardReady(keyboard_t *keyboard);
+
+void keyboardDestruct(keyboard_t *keyboard);
+
+#endif //CPU_KEYBOARD_H
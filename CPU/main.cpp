@@ -4,7 +4,19 @@
 #include <string.h>
 #include <math.h>
 #include <unistd.h>
-#include "stack.h"
+#include "cpu.h"
+#include "render.h"
+#include "framebuffer.h"
+#include "dma.h"
+#include "snapshot.h"
+#include "vector.h"
+#include "memo.h"
+#include "natives.h"
+#include "irq.h"
+#include "keyboard.h"
+#include "perf.h"
+#include "bus.h"
+#include "process.h"
 
 #define ANSI_COLOR_RED "\x1b[31m"
 #define ANSI_COLOR_GREEN "\x1b[32m"
@@ -25,42 +37,134 @@
 #define ANSI_BGCOLOR_RESET "\x1b[49m"
 #define ANSI_BGCOLOR_DUMMY "\x1b[4%dm  "
 
-const size_t RAM_SIZE = 1024;
+const char *defaultFilename = "prog.bin";
 
-const size_t WIDTH = 64;
+const char *defaultRenderer = "ansi";
+
+const char *defaultSnapshot = "snapshot.bin";
+
+struct params_t {
+    char *filename;
+    const renderer_t *renderer;
+    const char *framebufferName;
+    bool notifyFrames;
+    size_t ramSize;
+    const char *ramFile;
+    const char *snapshotFile;
+    const char *restoreFile;
+    const char *plugins[MAX_PLUGINS];
+    int pluginsNum;
+};
+
+// Devices on the bus, each one is mapped at MMIO_BASE + slot * BUS_SLOT_SIZE, i.e. console at -4096, keyboard at -3840...
+enum deviceSlots {
+    DEVICE_CONSOLE,
+    DEVICE_KEYBOARD,
+    DEVICE_DISPLAY,
+    DEVICE_TIMER,
+    DEVICE_COUNTERS
+};
+
+// Console: reading NUMBER waits for a number on stdin, writing prints it. Writing CHAR prints a character.
+enum consoleRegisters {
+    CONSOLE_NUMBER,
+    CONSOLE_CHAR
+};
+
+// Keyboard: same values as key and keyready
+enum keyboardRegisters {
+    KEYBOARD_KEY,
+    KEYBOARD_READY
+};
+
+// Display: writing COLOR plots a pixel at X, Y, writing FRAME draws the screen
+enum displayRegisters {
+    DISPLAY_X,
+    DISPLAY_Y,
+    DISPLAY_COLOR,
+    DISPLAY_FRAME,
+    DISPLAY_TILESET,
+    DISPLAY_TILEMAP,
+    DISPLAY_SPRITES
+};
+
+// Timer: writing PERIOD programs the interval timer, writing DELAY sleeps for that many milliseconds
+enum timerRegisters {
+    TIMER_PERIOD,
+    TIMER_DELAY
+};
+
+/**
+ * State the memory-mapped devices work on. Counters device registers are the counters of perf.h.
+ */
+struct devices_t {
+    cpu_t *cpu;
+    const params_t *params;
+    framebuffer_t *framebuffer;
+    irq_t *irq;
+    keyboard_t *keyboard;
+    perf_t *perf;
+    int x;
+    int y;
+};
 
-const size_t HEIGHT = 64;
+int get_int();
 
-const char *defaultFilename = "prog.bin";
+num_t pop(stack_t *stk);
 
-int get_int();
+void push(stack_t *stk, num_t value);
 
-void setIntToRAM(int *RAM, size_t n, int val);
+void drawScreen(char *VRAM, const renderer_t *renderer);
 
-int pop(stack_t *stk);
+int setPixel(char *VRAM, unsigned int desc);
 
-void push(stack_t *stk, int value);
+int setPixelXY(char *VRAM, unsigned int x, unsigned int y, unsigned int color);
 
-void drawScreen(char *VRAM);
+void composeScreen(char *VRAM, ram_t *RAM, display_t *display);
 
-int setPixel(char *VRAM, unsigned int desc);
+void drawTile(char *VRAM, ram_t *RAM, display_t *display, int tile, int x0, int y0);
+
+int parseParams(int argc, char *argv[], params_t *params);
+
+int checkpoint(cpu_t *cpu, const char *path, const char *bin, int len, int pc, pid_t *writer);
+
+num_t peak_n(stack_t *stk, int n);
+
+void pick(stack_t *stk, int depth);
+
+void roll(stack_t *stk, int depth);
+
+char *getVRAMBlock(char *VRAM, size_t n, size_t count);
+
+void copyRAM(ram_t *RAM, size_t dst, size_t src, size_t count);
+
+void fillRAM(ram_t *RAM, size_t dst, num_t value, size_t count);
+
+int compareRAM(ram_t *RAM, size_t first, size_t second, size_t count);
+
+void blitRAM(char *VRAM, ram_t *RAM, size_t dst, size_t src, size_t count);
 
-int parseParams(int argc, char *argv[], char **filename);
+unsigned int irqHandlers(ram_t *RAM, const irq_t *irq);
 
-int peak_n(stack_t *stk, int n);
+void presentFrame(devices_t *devices);
 
-int getIntFromRAM(int *RAM, size_t n);
+void attachDevices(bus_t *bus, devices_t *devices);
 
 int loadFile(FILE **f, const char *loadpath, const char *mode);
 
 size_t fileSize(FILE *f);
 
-int execute(char *bin, int len);
+int execute(char *bin, int len, const params_t *params);
 
 int main(int argc, char *argv[]) {
-    char *filename = nullptr;
+    params_t params = {};
 
-    if (parseParams(argc, argv, &filename) == -1) return -1;
+    // Input interrupt polls fd 0, so "in" must not leave read-ahead in a stdio buffer where poll can not see it.
+    // Unbuffered stdin keeps at most the one character scanf pushes back, which is the delimiter after a number.
+    setvbuf(stdin, nullptr, _IONBF, 0);
+
+    if (parseParams(argc, argv, &params) == -1) return -1;
+    char *filename = params.filename;
 
     printf(ANSI_COLOR_BLUE "Executing file %s\n" ANSI_COLOR_RESET, filename);
 
@@ -75,7 +179,7 @@ int main(int argc, char *argv[]) {
     char *sourceCode = (char *) calloc(size + 1, sizeof(char));
     fread(sourceCode, sizeof(char), size, source);
     fclose(source);
-    if(!execute(sourceCode, size))
+    if(!execute(sourceCode, size, &params))
         return 0;
 
     free(sourceCode);
@@ -88,9 +192,9 @@ int get_int() {
     return value;
 }
 
-int pop(stack_t *stk) {
+num_t pop(stack_t *stk) {
     assert(stk);
-    int value = 0;
+    num_t value = 0;
     if (!stackPop(stk, &value)) {
         printf(ANSI_COLOR_RED "Stack underflow error! Terminating...\n" ANSI_COLOR_RESET);
         exit(-1);
@@ -98,81 +202,430 @@ int pop(stack_t *stk) {
     return value;
 }
 
-int peak_n(stack_t *stk, int n) {
+num_t peak_n(stack_t *stk, int n) {
     assert(stk);
-    auto values = (int *) calloc(n, sizeof(int));
-    for (int i = 0; i < n; i++) {
-        values[i] = pop(stk);
-    }
-    int value = values[n - 1];
-    for(int i = n - 1; i >= 0; i--) {
-        push(stk, values[i]);
+    num_t value = 0;
+    if ((n < 1) || !stackPeek(stk, n - 1, &value)) {
+        printf(ANSI_COLOR_RED "Stack underflow error! Terminating...\n" ANSI_COLOR_RESET);
+        exit(-1);
     }
-    free(values);
     return value;
 }
 
-void push(stack_t *stk, int value) {
+void pick(stack_t *stk, int depth) {
     assert(stk);
-    if (!stackPush(stk, value)) {
-        printf(ANSI_COLOR_RED "Stack overflow error! Terminating...\n" ANSI_COLOR_RESET);
+    if ((depth < 0) || !stackPick(stk, depth)) {
+        printf(ANSI_COLOR_RED "Stack underflow error! Terminating...\n" ANSI_COLOR_RESET);
         exit(-1);
     }
 }
 
-int getIntFromRAM(int *RAM, size_t n) {
-    assert(RAM);
-    if (n >= RAM_SIZE) {
-        printf(ANSI_COLOR_RED "Accessing non-existing RAM adress! Terminating...\n" ANSI_COLOR_RESET);
+void roll(stack_t *stk, int depth) {
+    assert(stk);
+    if ((depth < 0) || !stackRotate(stk, depth)) {
+        printf(ANSI_COLOR_RED "Stack underflow error! Terminating...\n" ANSI_COLOR_RESET);
+        exit(-1);
+    }
+}
+
+void push(stack_t *stk, num_t value) {
+    assert(stk);
+    if (!stackPush(stk, value)) {
+        printf(ANSI_COLOR_RED "Stack overflow error! Terminating...\n" ANSI_COLOR_RESET);
         exit(-1);
     }
-    return RAM[n];
 }
 
-void drawScreen(char *VRAM) {
+void drawScreen(char *VRAM, const renderer_t *renderer) {
     assert(VRAM);
+    // Frame pacing is only needed when something is shown, headless runs do not sleep
+    if (!renderer) return;
     usleep(18000);
-    printf("\033[1;1H");
-    for(int y = 0; y < HEIGHT; y++) {
-        for(int x = 0; x < WIDTH; x++) {
-            printf(ANSI_BGCOLOR_DUMMY ANSI_COLOR_RESET, VRAM[y * WIDTH + x]);
-        }
-        printf("\n");
-    }
+
+    char *frame = nullptr;
+    size_t frameSize = 0;
+    FILE *out = open_memstream(&frame, &frameSize);
+    fputs("\033[1;1H", out);
+    renderer->render(out, VRAM, WIDTH, HEIGHT);
+    fclose(out);
+
+    fwrite(frame, sizeof(char), frameSize, stdout);
+    fflush(stdout);
+    free(frame);
 }
 
 int setPixel(char *VRAM, unsigned int desc) {
+    return setPixelXY(VRAM, desc / 10000, desc / 10 % 1000, desc % 10);
+}
+
+int setPixelXY(char *VRAM, unsigned int x, unsigned int y, unsigned int color) {
     assert(VRAM);
-    unsigned int x = desc / 10000;
-    unsigned int y = desc / 10 % 1000;
     if((x >= WIDTH) || (y >= HEIGHT)) {
         printf(ANSI_COLOR_RED "Invalid coordinates x:%d y:%d. Terminating...\n" ANSI_COLOR_RESET, x, y);
         exit(-1);
     }
-    unsigned int color = desc % 10;
     VRAM[y * WIDTH + x] = (char) color;
+    return 1;
+}
+
+void copyRAM(ram_t *RAM, size_t dst, size_t src, size_t count) {
+    num_t *to = getRAMBlock(RAM, dst, count);
+    num_t *from = getRAMBlock(RAM, src, count);
+    memmove(to, from, count * sizeof(num_t));
 }
 
-void setIntToRAM(int *RAM, size_t n, int val) {
-    if (n >= RAM_SIZE) {
-        printf(ANSI_COLOR_RED "Accessing non-existing RAM adress! Terminating...\n" ANSI_COLOR_RESET);
+void fillRAM(ram_t *RAM, size_t dst, num_t value, size_t count) {
+    num_t *to = getRAMBlock(RAM, dst, count);
+    if (value == 0) {
+        memset(to, 0, count * sizeof(num_t));
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+        to[i] = value;
+}
+
+int compareRAM(ram_t *RAM, size_t first, size_t second, size_t count) {
+    num_t *a = getRAMBlock(RAM, first, count);
+    num_t *b = getRAMBlock(RAM, second, count);
+    if (a == b) return 0;
+    for (size_t i = 0; i < count; i++)
+        if (a[i] != b[i])
+            return (a[i] < b[i]) ? -1 : 1;
+    return 0;
+}
+
+char *getVRAMBlock(char *VRAM, size_t n, size_t count) {
+    assert(VRAM);
+    if ((n > WIDTH * HEIGHT) || (count > WIDTH * HEIGHT - n)) {
+        printf(ANSI_COLOR_RED "Blitting outside of VRAM! Terminating...\n" ANSI_COLOR_RESET);
         exit(-1);
     }
-    RAM[n] = val;
+    return VRAM + n;
 }
 
+void blitRAM(char *VRAM, ram_t *RAM, size_t dst, size_t src, size_t count) {
+    num_t *from = getRAMBlock(RAM, src, count);
+    char *to = getVRAMBlock(VRAM, dst, count);
+    for (size_t i = 0; i < count; i++)
+        to[i] = (char) numToInt(from[i]);
+}
 
-int execute(char *bin, int len) {
-    int precision = 100;
-    stack_t stk = {};
+void composeScreen(char *VRAM, ram_t *RAM, display_t *display) {
+    assert(VRAM);
+    assert(RAM);
+    assert(display);
+
+    if (display->tilemap >= 0) {
+        size_t columns = WIDTH / TILE_SIZE;
+        size_t rows = HEIGHT / TILE_SIZE;
+        num_t *map = getRAMBlock(RAM, display->tilemap, columns * rows);
+        for (size_t y = 0; y < rows; y++) {
+            for (size_t x = 0; x < columns; x++) {
+                drawTile(VRAM, RAM, display, numToInt(map[y * columns + x]), x * TILE_SIZE, y * TILE_SIZE);
+            }
+        }
+    }
+
+    if (display->sprites >= 0) {
+        int count = numToInt(getNumFromRAM(RAM, display->sprites));
+        if ((count < 0) || ((size_t) count > MAX_SPRITES)) {
+            printf(ANSI_COLOR_RED "Invalid sprite table of %d sprites! Terminating...\n" ANSI_COLOR_RESET, count);
+            exit(-1);
+        }
+        num_t *sprite = getRAMBlock(RAM, display->sprites + 1, count * SPRITE_ATTRS_NUM);
+        for (int i = 0; i < count; i++, sprite += SPRITE_ATTRS_NUM) {
+            drawTile(VRAM, RAM, display, numToInt(sprite[2]), numToInt(sprite[0]), numToInt(sprite[1]));
+        }
+    }
+}
+
+void drawTile(char *VRAM, ram_t *RAM, display_t *display, int tile, int x0, int y0) {
+    assert(VRAM);
+    assert(RAM);
+    assert(display);
+
+    if (tile < 0) return;
+    if (display->tileset < 0) {
+        printf(ANSI_COLOR_RED "Tile set is not defined! Terminating...\n" ANSI_COLOR_RESET);
+        exit(-1);
+    }
+    num_t *pixels = getRAMBlock(RAM, display->tileset + tile * TILE_SIZE * TILE_SIZE, TILE_SIZE * TILE_SIZE);
+    for (int y = 0; y < (int) TILE_SIZE; y++) {
+        if ((y0 + y < 0) || ((size_t) (y0 + y) >= HEIGHT)) continue;
+        for (int x = 0; x < (int) TILE_SIZE; x++) {
+            int color = numToInt(pixels[y * TILE_SIZE + x]);
+            if ((color < 0) || (x0 + x < 0) || ((size_t) (x0 + x) >= WIDTH)) continue;
+            VRAM[(y0 + y) * WIDTH + x0 + x] = (char) color;
+        }
+    }
+}
+
+
+/**
+ * Reads vector table
+ * @param RAM Pointer to RAM
+ * @param irq Pointer to interrupt controller
+ * @return Mask of interrupt lines that have a handler
+ */
+unsigned int irqHandlers(ram_t *RAM, const irq_t *irq) {
+    assert(RAM);
+    assert(irq);
+
+    unsigned int handled = 0;
+    if (irq->vectors < 0) return handled;
+    for (int line = 0; line < IRQ_LINES_NUM; line++)
+        if (numToInt(getNumFromRAM(RAM, irq->vectors + line)) != 0)
+            handled |= 1u << line;
+    return handled;
+}
+
+// Composes, publishes and renders the screen
+void presentFrame(devices_t *devices) {
+    assert(devices);
+
+    cpu_t *cpu = devices->cpu;
+    composeScreen(cpu->VRAM, &cpu->ram, &cpu->display);
+    if (devices->framebuffer->header) framebufferPublish(devices->framebuffer, cpu->VRAM);
+    drawScreen(cpu->VRAM, devices->params->renderer);
+    irqStartVBlank(devices->irq);
+    devices->perf->frames++;
+}
+
+static num_t consoleRead(void *context, size_t offset) {
+    auto devices = (devices_t *) context;
+    if (offset != CONSOLE_NUMBER) return 0;
+
+    num_t value = numFromInt(get_int());
+    irqRearmInput(devices->irq);
+    return value;
+}
+
+static void consoleWrite(void *, size_t offset, num_t value) {
+    if (offset == CONSOLE_NUMBER)
+        numPrint(stdout, value);
+    else if (offset == CONSOLE_CHAR)
+        putchar((int) numToInt(value));
+}
+
+static num_t keyboardDeviceRead(void *context, size_t offset) {
+    auto devices = (devices_t *) context;
+    if (!keyboardStart(devices->keyboard)) return numFromInt(-1);
+
+    switch (offset) {
+        case KEYBOARD_KEY:
+            return numFromInt(keyboardRead(devices->keyboard));
+        case KEYBOARD_READY:
+            return numFromInt(keyboardReady(devices->keyboard));
+        default:
+            return 0;
+    }
+}
+
+static num_t displayRead(void *context, size_t offset) {
+    auto devices = (devices_t *) context;
+    display_t *display = &devices->cpu->display;
+
+    switch (offset) {
+        case DISPLAY_X:
+            return numFromInt(devices->x);
+        case DISPLAY_Y:
+            return numFromInt(devices->y);
+        case DISPLAY_TILESET:
+            return numFromInt(display->tileset);
+        case DISPLAY_TILEMAP:
+            return numFromInt(display->tilemap);
+        case DISPLAY_SPRITES:
+            return numFromInt(display->sprites);
+        default:
+            return 0;
+    }
+}
+
+static void displayWrite(void *context, size_t offset, num_t value) {
+    auto devices = (devices_t *) context;
+    display_t *display = &devices->cpu->display;
+
+    switch (offset) {
+        case DISPLAY_X:
+            devices->x = numToInt(value);
+            break;
+        case DISPLAY_Y:
+            devices->y = numToInt(value);
+            break;
+        case DISPLAY_COLOR:
+            setPixelXY(devices->cpu->VRAM, devices->x, devices->y, numToInt(value));
+            break;
+        case DISPLAY_FRAME:
+            presentFrame(devices);
+            break;
+        case DISPLAY_TILESET:
+            display->tileset = numToInt(value);
+            break;
+        case DISPLAY_TILEMAP:
+            display->tilemap = numToInt(value);
+            break;
+        case DISPLAY_SPRITES:
+            display->sprites = numToInt(value);
+            break;
+    }
+}
+
+static void timerWrite(void *context, size_t offset, num_t value) {
+    auto devices = (devices_t *) context;
+
+    if (offset == TIMER_PERIOD)
+        irqSetTimer(devices->irq, numToInt(value));
+    else if (offset == TIMER_DELAY)
+        usleep(numToInt(value) * 1000);
+}
+
+static num_t countersRead(void *context, size_t offset) {
+    auto devices = (devices_t *) context;
+
+    unsigned long long value = 0;
+    perfRead(devices->perf, &devices->cpu->ram, offset, &value);
+    return numFromCounter(value);
+}
+
+void attachDevices(bus_t *bus, devices_t *devices) {
+    assert(bus);
+    assert(devices);
+
+    const device_t console = {"console", devices, consoleRead, consoleWrite};
+    const device_t keyboard = {"keyboard", devices, keyboardDeviceRead, nullptr};
+    const device_t display = {"display", devices, displayRead, displayWrite};
+    const device_t timer = {"timer", devices, nullptr, timerWrite};
+    const device_t counters = {"counters", devices, countersRead, nullptr};
+    busAttach(bus, DEVICE_CONSOLE, &console);
+    busAttach(bus, DEVICE_KEYBOARD, &keyboard);
+    busAttach(bus, DEVICE_DISPLAY, &display);
+    busAttach(bus, DEVICE_TIMER, &timer);
+    busAttach(bus, DEVICE_COUNTERS, &counters);
+}
+
+/**
+ * Saves snapshot in a forked child, so the VM keeps running while it is written.
+ * The previous writer is waited for first, so snapshots are published in order and never overlap.
+ * @param cpu Machine state
+ * @param path Snapshot path
+ * @param bin Program being executed
+ * @param len Program length
+ * @param pc Offset of the instruction to resume from
+ * @param writer Pid of the background writer, -1 if there is none
+ * @return 1 if successful, 0 otherwise
+ */
+int checkpoint(cpu_t *cpu, const char *path, const char *bin, int len, int pc, pid_t *writer) {
+    assert(cpu);
+    assert(path);
+    assert(writer);
+
+    int previous = waitChild(*writer);
+    *writer = -1;
+    if (!previous)
+        printf(ANSI_COLOR_YELLOW "Previous snapshot %s was not written\n" ANSI_COLOR_RESET, path);
+
+    // Shared file mapping is not copied on fork, so it has to be saved synchronously
+    if (cpu->ram.fileBacked)
+        return snapshotSave(path, cpu, bin, len, pc);
+
+    // Child of a multithreaded process must not allocate, so the file is prepared here
+    snapshot_writer_t snapshot = {};
+    if (!snapshotBegin(&snapshot, path)) return 0;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+        _exit(snapshotWrite(&snapshot, cpu, bin, len, pc) ? 0 : -1);
+    if (pid == -1) unlink(snapshot.tmpPath);
+    snapshotEnd(&snapshot);
+    *writer = pid;
+    return pid != -1;
+}
+
+int execute(char *bin, int len, const params_t *params) {
+    cpu_t cpu = {};
+    stack_t &stk = cpu.stk;
     stackConstruct(&stk, "CPUStack", 1024, 4417);
-    auto RAM = (int *) calloc(RAM_SIZE, sizeof(int));
-    auto VRAM = (char *) calloc(WIDTH * HEIGHT, sizeof(char));
-    int registers[4] = {};
+    if (params->ramFile) {
+        if (!ramMapFile(&cpu.ram, params->ramFile, params->ramSize)) {
+            printf(ANSI_COLOR_RED "Unable to map RAM onto %s. Terminating...\n" ANSI_COLOR_RESET, params->ramFile);
+            return 0;
+        }
+    } else if (!params->restoreFile && !ramConstruct(&cpu.ram, params->ramSize ? params->ramSize : DEFAULT_RAM_SIZE)) {
+        printf(ANSI_COLOR_RED "Unable to allocate %zu RAM cells. Terminating...\n" ANSI_COLOR_RESET, params->ramSize);
+        return 0;
+    }
+    cpu.VRAM = (char *) calloc(WIDTH * HEIGHT, sizeof(char));
+    cpu.display = {-1, -1, -1};
+    int pc = 0;
+    if (params->restoreFile && !snapshotLoad(params->restoreFile, &cpu, bin, len, &pc)) {
+        printf(ANSI_COLOR_RED "Unable to restore snapshot %s. Terminating...\n" ANSI_COLOR_RESET, params->restoreFile);
+        return 0;
+    }
+    ram_t *RAM = &cpu.ram;
+    char *VRAM = cpu.VRAM;
+    num_t *registers = cpu.registers;
+    int *indexes = cpu.indexes;
+    int &flags = cpu.flags;
+    int *calls = cpu.calls;
+    int &callDepth = cpu.callDepth;
+    num_t *frames = cpu.frames;
+    int &bp = cpu.bp;
+    int &frameTop = cpu.frameTop;
+    display_t &display = cpu.display;
+    auto dma = new dma_t;
+    dmaConstruct(dma);
+    auto memo = new memo_t;
+    memoConstruct(memo);
+    auto natives = new vm_t;
+    nativesConstruct(natives, &cpu);
+    for (int i = 0; i < params->pluginsNum; i++) {
+        if (!nativesLoadPlugin(natives, params->plugins[i])) {
+            printf(ANSI_COLOR_RED "Unable to load plugin %s. Terminating...\n" ANSI_COLOR_RESET, params->plugins[i]);
+            return 0;
+        }
+    }
+    auto irq = new irq_t;
+    irqConstruct(irq);
+    auto keyboard = new keyboard_t;
+    keyboardConstruct(keyboard, irq);
+    perf_t perf = {};
+    perfConstruct(&perf);
+    framebuffer_t framebuffer = {};
+    if (params->framebufferName &&
+        !framebufferCreate(&framebuffer, params->framebufferName, WIDTH, HEIGHT, params->notifyFrames)) {
+        printf(ANSI_COLOR_RED "Unable to create framebuffer %s. Terminating...\n" ANSI_COLOR_RESET, params->framebufferName);
+        return 0;
+    }
+    pid_t snapshotWriter = -1;
+    devices_t devices = {&cpu, params, &framebuffer, irq, keyboard, &perf, 0, 0};
+    auto bus = new bus_t;
+    busConstruct(bus);
+    attachDevices(bus, &devices);
+    RAM->bus = bus;
     char *binStart = bin;
+    bin += pc;
     char cmd = 0;
     int arg = 0;
     while((bin - binStart) < len) {
+        if (irq->enabled && irq->pending.load(std::memory_order_relaxed)) {
+            int line = irqNext(irq, irqHandlers(RAM, irq));
+            if (line != -1) {
+                int handler = numToInt(getNumFromRAM(RAM, irq->vectors + line));
+                if ((handler < 0) || (handler >= len)) {
+                    printf(ANSI_COLOR_RED "Interrupt handler %d is outside the program. Terminating..." ANSI_COLOR_RESET, handler);
+                    return 0;
+                }
+                if (callDepth + 2 > CALL_STACK_DEPTH) {
+                    printf(ANSI_COLOR_RED "Call stack overflow error! Terminating..." ANSI_COLOR_RESET);
+                    return 0;
+                }
+                calls[callDepth++] = flags;
+                calls[callDepth++] = bin - binStart;
+                irq->enabled = false;
+                bin = binStart + handler;
+            }
+        }
+        perf.retired++;
 
 #define DEF_CMD(name, args, overloaders) \
         overloaders \
@@ -195,20 +648,91 @@ int execute(char *bin, int len) {
 
         bin++;
     }
+    RAM->bus = nullptr;
+    delete bus;
+    keyboardDestruct(keyboard);
+    delete keyboard;
+    irqDestruct(irq);
+    delete irq;
+    dmaDestruct(dma);
+    delete dma;
+    memoPrintStats(stderr, memo);
+    memoDestruct(memo);
+    delete memo;
+    nativesDestruct(natives);
+    delete natives;
     stackDestruct(&stk);
-    free(RAM);
+    framebufferDestroy(&framebuffer);
+    ramDestruct(RAM);
     free(VRAM);
+    if (!waitChild(snapshotWriter))
+        printf(ANSI_COLOR_YELLOW "Snapshot %s was not written\n" ANSI_COLOR_RESET, params->snapshotFile);
     return 1;
 }
 
-int parseParams(int argc, char *argv[], char **filename) {
-    if (argc == 1) {
+int parseParams(int argc, char *argv[], params_t *params) {
+    assert(params);
+
+    const char *renderer = defaultRenderer;
+    params->snapshotFile = defaultSnapshot;
+
+    int option = 0;
+    while ((option = getopt(argc, argv, "r:s:em:f:c:l:p:")) != -1) {
+        switch (option) {
+            case 'r':
+                renderer = optarg;
+                break;
+            case 's':
+                params->framebufferName = optarg;
+                if (renderer == defaultRenderer) renderer = nullptr;
+                break;
+            case 'e':
+                params->notifyFrames = true;
+                break;
+            case 'm':
+                params->ramSize = strtoull(optarg, nullptr, 0);
+                if ((params->ramSize == 0) || (params->ramSize > MAX_RAM_SIZE)) {
+                    printf(ANSI_COLOR_RED "RAM size should be between 1 and %zu cells. Terminating...\n" ANSI_COLOR_RESET, MAX_RAM_SIZE);
+                    return -1;
+                }
+                break;
+            case 'f':
+                params->ramFile = optarg;
+                break;
+            case 'c':
+                params->snapshotFile = optarg;
+                break;
+            case 'l':
+                params->restoreFile = optarg;
+                break;
+            case 'p':
+                if (params->pluginsNum == MAX_PLUGINS) {
+                    printf(ANSI_COLOR_RED "At most %d plugins can be loaded. Terminating...\n" ANSI_COLOR_RESET, MAX_PLUGINS);
+                    return -1;
+                }
+                params->plugins[params->pluginsNum++] = optarg;
+                break;
+            default:
+                printf(ANSI_COLOR_RED "Usage: %s [-r ansi|halfblock|sixel] [-s shm_name [-e]] [-m ram_cells] [-f ram_file] [-c snapshot] [-l snapshot] [-p plugin.so]... [file]. Terminating...\n" ANSI_COLOR_RESET, argv[0]);
+                return -1;
+        }
+    }
+
+    if (renderer) {
+        params->renderer = findRenderer(renderer);
+        if (!params->renderer) {
+            printf(ANSI_COLOR_RED "Unknown renderer %s. Terminating...\n" ANSI_COLOR_RESET, renderer);
+            return -1;
+        }
+    }
+
+    if (optind == argc) {
         printf(ANSI_COLOR_YELLOW "Neither file nor compiler type specified. Using default parameters\n" ANSI_COLOR_RESET);
-        *filename = (char *)calloc(strlen(defaultFilename) + 1, sizeof(char));
-        strcpy(*filename, defaultFilename);
-    } else if (argc == 2) {
-        *filename = (char *)calloc(strlen(argv[1]) + 1, sizeof(char));
-        strcpy(*filename, argv[1]);
+        params->filename = (char *)calloc(strlen(defaultFilename) + 1, sizeof(char));
+        strcpy(params->filename, defaultFilename);
+    } else if (optind + 1 == argc) {
+        params->filename = (char *)calloc(strlen(argv[optind]) + 1, sizeof(char));
+        strcpy(params->filename, argv[optind]);
     } else {
         printf(ANSI_COLOR_RED "Invalid number of arguments. Terminating...\n" ANSI_COLOR_RESET);
         return -1;
@@ -0,0 +1,123 @@
+#include "memo.h"
+#include "MurMurHash3.h"
+#include <assert.h>
+#include <string.h>
+
+const unsigned int MEMO_HASH_SEED = 0x4D454D4F; // "MEMO"
+
+static size_t memoSlot(const memo_entry_t *key) {
+    assert(key);
+
+    num_t hashed[MEMO_MAX_ARGS + 1] = {};
+    hashed[0] = key->function;
+    memcpy(hashed + 1, key->args, key->argsNum * sizeof(num_t));
+    return MurMurHash3_32(hashed, (key->argsNum + 1) * sizeof(num_t), MEMO_HASH_SEED) % MEMO_CACHE_SIZE;
+}
+
+int memoConstruct(memo_t *memo) {
+    assert(memo);
+
+    memo->entries = (memo_entry_t *) calloc(MEMO_CACHE_SIZE, sizeof(memo_entry_t));
+    memo->pendingNum = 0;
+    memo->hits = 0;
+    memo->misses = 0;
+    memo->evictions = 0;
+    return memo->entries != nullptr;
+}
+
+/**
+ * Looks up call of a pure function. On a hit arguments are replaced with cached results on the stack,
+ * on a miss the call is remembered so that memoReturn can cache its results.
+ * @param memo Pointer to cache
+ * @param stk Operand stack
+ * @param function Pointer to the first instruction of the callee
+ * @param functionAddress Offset of the callee in the program
+ * @param len Program length
+ * @param callDepth Call stack depth before the call
+ * @param returnAddress Return address the call will push
+ * @return true if the call can be skipped
+ */
+bool memoCall(memo_t *memo, stack_t *stk, const char *function, int functionAddress, int len, int callDepth, int returnAddress) {
+    assert(memo);
+    assert(stk);
+    assert(function);
+    assert(*function == PURE_OPCODE);
+
+    // Marker operands past the end of a truncated program are not read, the call just is not cached
+    if ((functionAddress < 0) || ((size_t) functionAddress + 1 + 2 * sizeof(int) > (size_t) len))
+        return false;
+
+    memo_entry_t key = {};
+    key.used = true;
+    key.function = functionAddress;
+    key.argsNum = *((const int *) (function + 1));
+    key.resultsNum = *((const int *) (function + 1) + 1);
+    if ((key.argsNum < 0) || (key.argsNum > MEMO_MAX_ARGS) || ((size_t) key.argsNum > stk->size) ||
+        (key.resultsNum < 0) || (key.resultsNum > MEMO_MAX_RESULTS))
+        return false;
+    for (int i = 0; i < key.argsNum; i++)
+        stackPeek(stk, i, &key.args[i]);
+
+    const memo_entry_t *entry = memo->entries + memoSlot(&key);
+    if (entry->used && (entry->function == key.function) && (entry->argsNum == key.argsNum) &&
+        (memcmp(entry->args, key.args, key.argsNum * sizeof(num_t)) == 0)) {
+        memo->hits++;
+        num_t value = 0;
+        for (int i = 0; i < entry->argsNum; i++)
+            stackPop(stk, &value);
+        for (int i = entry->resultsNum - 1; i >= 0; i--)
+            stackPush(stk, entry->results[i]);
+        return true;
+    }
+
+    memo->misses++;
+    if (memo->pendingNum < MEMO_MAX_PENDING) {
+        memo->pending[memo->pendingNum] = key;
+        memo->pendingDepth[memo->pendingNum] = callDepth;
+        memo->pendingReturn[memo->pendingNum++] = returnAddress;
+    }
+    return false;
+}
+
+/**
+ * Caches results of the pure call that is returning, if there is one
+ * @param memo Pointer to cache
+ * @param stk Operand stack with results on top
+ * @param callDepth Call stack depth after the return
+ * @param returnAddress Return address popped from the call stack
+ */
+void memoReturn(memo_t *memo, stack_t *stk, int callDepth, int returnAddress) {
+    assert(memo);
+    assert(stk);
+
+    // Calls left without ret, e.g. by jumps, are dropped
+    while ((memo->pendingNum > 0) && (memo->pendingDepth[memo->pendingNum - 1] > callDepth))
+        memo->pendingNum--;
+    if ((memo->pendingNum == 0) || (memo->pendingDepth[memo->pendingNum - 1] != callDepth)) return;
+
+    memo_entry_t *key = memo->pending + --memo->pendingNum;
+    if (memo->pendingReturn[memo->pendingNum] != returnAddress) return;
+    if ((size_t) key->resultsNum > stk->size) return;
+    for (int i = 0; i < key->resultsNum; i++)
+        stackPeek(stk, i, &key->results[i]);
+
+    memo_entry_t *entry = memo->entries + memoSlot(key);
+    if (entry->used) memo->evictions++;
+    *entry = *key;
+}
+
+void memoPrintStats(FILE *f, const memo_t *memo) {
+    assert(f);
+    assert(memo);
+
+    if (memo->hits + memo->misses == 0) return;
+    fprintf(f, "Pure calls: %lu hits, %lu misses (%.1lf%%), %lu evictions\n", memo->hits, memo->misses,
+            100.0 * memo->hits / (memo->hits + memo->misses), memo->evictions);
+}
+
+void memoDestruct(memo_t *memo) {
+    assert(memo);
+
+    free(memo->entries);
+    memo->entries = nullptr;
+}
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "stack.h"
+
+#ifndef CPU_MEMO_H
+#define CPU_MEMO_H
+
+// Opcode of "pure in, out" marker that starts a pure function, see commands.h
+const char PURE_OPCODE = 105;
+
+const size_t MEMO_CACHE_SIZE = 4096;
+
+const int MEMO_MAX_ARGS = 4;
+
+const int MEMO_MAX_RESULTS = 4;
+
+const int MEMO_MAX_PENDING = 256;
+
+/**
+ * Cached call: function address and arguments from the top of the stack down map to its results
+ */
+struct memo_entry_t {
+    bool used;
+    int function;
+    int argsNum;
+    num_t args[MEMO_MAX_ARGS];
+    int resultsNum;
+    num_t results[MEMO_MAX_RESULTS];
+};
+
+/**
+ * Direct-mapped result cache of pure functions. Calls that missed are pending until their ret.
+ */
+struct memo_t {
+    memo_entry_t *entries;
+    memo_entry_t pending[MEMO_MAX_PENDING];
+    int pendingDepth[MEMO_MAX_PENDING];
+    int pendingReturn[MEMO_MAX_PENDING];
+    int pendingNum;
+
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+};
+
+int memoConstruct(memo_t *memo);
+
+bool memoCall(memo_t *memo, stack_t *stk, const char *function, int functionAddress, int len, int callDepth, int returnAddress);
+
+void memoReturn(memo_t *memo, stack_t *stk, int callDepth, int returnAddress);
+
+void memoPrintStats(FILE *f, const memo_t *memo);
+
+void memoDestruct(memo_t *memo);
+
+#endif //CPU_MEMO_H
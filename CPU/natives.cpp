@@ -0,0 +1,176 @@
+#include "natives.h"
+#include "MurMurHash3.h"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <algorithm>
+
+const unsigned int NATIVE_HASH_SEED = 0x48415348; // "HASH"
+
+static int apiPop(vm_t *vm, num_t *value) {
+    return stackPop(&vm->cpu->stk, value);
+}
+
+static int apiPush(vm_t *vm, num_t value) {
+    return stackPush(&vm->cpu->stk, value);
+}
+
+static int apiPeek(vm_t *vm, size_t depth, num_t *value) {
+    return stackPeek(&vm->cpu->stk, depth, value);
+}
+
+static num_t *apiRegister(vm_t *vm, int n) {
+    return ((n < 0) || (n >= REGS_NUM)) ? nullptr : vm->cpu->registers + n;
+}
+
+static num_t *apiRAM(vm_t *vm, size_t address, size_t count) {
+    ram_t *ram = &vm->cpu->ram;
+    return ((address > ram->size) || (count > ram->size - address)) ? nullptr : ram->cells + address;
+}
+
+static size_t apiRAMSize(vm_t *vm) {
+    return vm->cpu->ram.size;
+}
+
+static int apiRegisterNative(vm_t *vm, int n, const char *name, vm_native_t native) {
+    if ((n < 0) || (n >= NATIVES_NUM) || !native || vm->natives[n].function) return 0;
+    vm->natives[n] = {name, native};
+    return 1;
+}
+
+const vm_api_t vmApi = {
+        VM_API_VERSION,
+        NUMERIC_MODEL_ID,
+        NUM_ONE,
+        apiPop,
+        apiPush,
+        apiPeek,
+        apiRegister,
+        apiRAM,
+        apiRAMSize,
+        apiRegisterNative
+};
+
+// Pops count and address of a RAM range pushed in this order
+static num_t *popRAMRange(vm_t *vm, const vm_api_t *api, size_t *count) {
+    num_t countValue = 0, address = 0;
+    if (!api->pop(vm, &countValue) || !api->pop(vm, &address) || (countValue < 0) || (address < 0)) return nullptr;
+    *count = numToInt(countValue);
+    return api->ram(vm, numToInt(address), *count);
+}
+
+// sys 0: sorts RAM range ascending, stack: address, count
+static int nativeSort(vm_t *vm, const vm_api_t *api) {
+    size_t count = 0;
+    num_t *cells = popRAMRange(vm, api, &count);
+    if (!cells) return 0;
+    std::sort(cells, cells + count);
+    return 1;
+}
+
+// sys 1: bucket of RAM range contents, stack: address, count, buckets -> bucket
+static int nativeHash(vm_t *vm, const vm_api_t *api) {
+    num_t buckets = 0;
+    if (!api->pop(vm, &buckets) || (numToInt(buckets) <= 0)) return 0;
+    size_t count = 0;
+    num_t *cells = popRAMRange(vm, api, &count);
+    if (!cells) return 0;
+    unsigned long hash = MurMurHash3_32(cells, count * sizeof(num_t), NATIVE_HASH_SEED);
+    return api->push(vm, numFromInt(hash % numToInt(buckets)));
+}
+
+// Domain errors and overflows fail the native instead of pushing garbage
+static int pushDouble(vm_t *vm, const vm_api_t *api, double value) {
+    if (!numFitsDouble(value)) return 0;
+    return api->push(vm, numFromDouble(value));
+}
+
+#define DEF_MATH_NATIVE(name, expression) \
+static int name(vm_t *vm, const vm_api_t *api) { \
+    num_t value = 0; \
+    if (!api->pop(vm, &value)) return 0; \
+    double x = numToDouble(value); \
+    return pushDouble(vm, api, expression); \
+}
+
+DEF_MATH_NATIVE(nativeSin, sin(x))
+
+DEF_MATH_NATIVE(nativeCos, cos(x))
+
+DEF_MATH_NATIVE(nativeExp, exp(x))
+
+DEF_MATH_NATIVE(nativeLog, log(x))
+
+#undef DEF_MATH_NATIVE
+
+// sys 6: stack: base, exponent -> power
+static int nativePow(vm_t *vm, const vm_api_t *api) {
+    num_t base = 0, exponent = 0;
+    if (!api->pop(vm, &exponent) || !api->pop(vm, &base)) return 0;
+    return pushDouble(vm, api, pow(numToDouble(base), numToDouble(exponent)));
+}
+
+/**
+ * Initializes native table with built-in functions
+ * @param vm Pointer to native interface state
+ * @param cpu Machine the natives operate on
+ */
+void nativesConstruct(vm_t *vm, cpu_t *cpu) {
+    assert(vm);
+    assert(cpu);
+
+    vm->cpu = cpu;
+    for (int i = 0; i < NATIVES_NUM; i++)
+        vm->natives[i] = {nullptr, nullptr};
+    vm->pluginsNum = 0;
+
+    apiRegisterNative(vm, NATIVE_SORT, "sort", nativeSort);
+    apiRegisterNative(vm, NATIVE_HASH, "hash", nativeHash);
+    apiRegisterNative(vm, NATIVE_SIN, "sin", nativeSin);
+    apiRegisterNative(vm, NATIVE_COS, "cos", nativeCos);
+    apiRegisterNative(vm, NATIVE_EXP, "exp", nativeExp);
+    apiRegisterNative(vm, NATIVE_LOG, "log", nativeLog);
+    apiRegisterNative(vm, NATIVE_POW, "pow", nativePow);
+}
+
+/**
+ * Loads shared library and calls its VM_PLUGIN_INIT entry, which registers the plugin's natives
+ * @param vm Pointer to native interface state
+ * @param path Path to the library
+ * @return 1 if successful, 0 otherwise
+ */
+int nativesLoadPlugin(vm_t *vm, const char *path) {
+    assert(vm);
+    assert(path);
+
+    if (vm->pluginsNum == MAX_PLUGINS) return 0;
+    void *plugin = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!plugin) return 0;
+
+    // Natives registered before a failed init must not outlive the library
+    native_entry_t natives[NATIVES_NUM] = {};
+    memcpy(natives, vm->natives, sizeof(natives));
+    auto init = (vm_plugin_init_t) dlsym(plugin, VM_PLUGIN_INIT);
+    if (!init || !init(vm, &vmApi)) {
+        memcpy(vm->natives, natives, sizeof(natives));
+        dlclose(plugin);
+        return 0;
+    }
+    vm->plugins[vm->pluginsNum++] = plugin;
+    return 1;
+}
+
+const native_entry_t *nativesFind(const vm_t *vm, int n) {
+    assert(vm);
+
+    return ((n < 0) || (n >= NATIVES_NUM) || !vm->natives[n].function) ? nullptr : vm->natives + n;
+}
+
+void nativesDestruct(vm_t *vm) {
+    assert(vm);
+
+    for (int i = 0; i < vm->pluginsNum; i++)
+        dlclose(vm->plugins[i]);
+    vm->pluginsNum = 0;
+}
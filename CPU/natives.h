@@ -0,0 +1,48 @@
+#include <stdlib.h>
+#include "cpu.h"
+#include "vmapi.h"
+
+#ifndef CPU_NATIVES_H
+#define CPU_NATIVES_H
+
+const int NATIVES_NUM = 256;
+
+const int MAX_PLUGINS = 16;
+
+// Built-in natives, plugins can take any other free number
+enum builtinNatives {
+    NATIVE_SORT,
+    NATIVE_HASH,
+    NATIVE_SIN,
+    NATIVE_COS,
+    NATIVE_EXP,
+    NATIVE_LOG,
+    NATIVE_POW
+};
+
+struct native_entry_t {
+    const char *name;
+    vm_native_t function;
+};
+
+/**
+ * Host side of vmapi.h: table of "sys n" targets and loaded plugins
+ */
+struct vm_t {
+    cpu_t *cpu;
+    native_entry_t natives[NATIVES_NUM];
+    void *plugins[MAX_PLUGINS];
+    int pluginsNum;
+};
+
+extern const vm_api_t vmApi;
+
+void nativesConstruct(vm_t *vm, cpu_t *cpu);
+
+int nativesLoadPlugin(vm_t *vm, const char *path);
+
+const native_entry_t *nativesFind(const vm_t *vm, int n);
+
+void nativesDestruct(vm_t *vm);
+
+#endif //CPU_NATIVES_H
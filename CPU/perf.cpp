@@ -0,0 +1,45 @@
+#include "perf.h"
+#include <assert.h>
+
+void perfConstruct(perf_t *perf) {
+    assert(perf);
+
+    perf->start = std::chrono::steady_clock::now();
+    perf->retired = 0;
+    perf->frames = 0;
+}
+
+/**
+ * Reads counter
+ * @param perf Pointer to counters
+ * @param ram RAM whose accesses are counted
+ * @param counter One of perfCounters
+ * @param value Counter value
+ * @return 1 if successful, 0 if there is no such counter
+ */
+int perfRead(const perf_t *perf, const ram_t *ram, int counter, unsigned long long *value) {
+    assert(perf);
+    assert(ram);
+    assert(value);
+
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - perf->start;
+    switch (counter) {
+        case PERF_MILLISECONDS:
+            *value = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+            return 1;
+        case PERF_INSTRUCTIONS:
+            *value = perf->retired;
+            return 1;
+        case PERF_RAM_ACCESSES:
+            *value = ram->accesses;
+            return 1;
+        case PERF_FRAMES:
+            *value = perf->frames;
+            return 1;
+        case PERF_MICROSECONDS:
+            *value = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+            return 1;
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,31 @@
+#include <stdlib.h>
+#include <chrono>
+#include "ram.h"
+
+#ifndef CPU_PERF_H
+#define CPU_PERF_H
+
+// Counters readable with "rdperf n"
+enum perfCounters {
+    PERF_MILLISECONDS,
+    PERF_INSTRUCTIONS,
+    PERF_RAM_ACCESSES,
+    PERF_FRAMES,
+    PERF_MICROSECONDS,
+    PERF_COUNTERS_NUM
+};
+
+/**
+ * Performance counters of a running program. Host time is monotonic and starts with the program.
+ */
+struct perf_t {
+    std::chrono::steady_clock::time_point start;
+    unsigned long long retired;
+    unsigned long long frames;
+};
+
+void perfConstruct(perf_t *perf);
+
+int perfRead(const perf_t *perf, const ram_t *ram, int counter, unsigned long long *value);
+
+#endif //CPU_PERF_H
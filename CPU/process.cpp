@@ -0,0 +1,15 @@
+#include "process.h"
+#include <sys/wait.h>
+
+/**
+ * Waits for child process, e.g. background snapshot writer
+ * @param pid Child pid, -1 if there is none
+ * @return 1 if there is no child or it exited successfully, 0 otherwise
+ */
+int waitChild(pid_t pid) {
+    if (pid == -1) return 1;
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) == -1) return 0;
+    return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
@@ -0,0 +1,10 @@
+#ifndef CPU_PROCESS_H
+#define CPU_PROCESS_H
+
+// Kept apart from stack.h: <sys/wait.h> declares its own stack_t
+
+#include <sys/types.h>
+
+int waitChild(pid_t pid);
+
+#endif //CPU_PROCESS_H
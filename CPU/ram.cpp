@@ -0,0 +1,146 @@
+#include "ram.h"
+#include <assert.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ANSI_COLOR_RED "\x1b[31m"
+#define ANSI_COLOR_RESET "\x1b[0m"
+
+/**
+ * Reserves address space for RAM without committing memory, untouched pages read as zeros
+ * @param ram Pointer to ram_t structure
+ * @param size Number of cells, up to MAX_RAM_SIZE
+ * @return 1 if successful, 0 otherwise
+ */
+int ramConstruct(ram_t *ram, size_t size) {
+    assert(ram);
+
+    if ((size == 0) || (size > MAX_RAM_SIZE)) return 0;
+
+    void *cells = mmap(nullptr, size * sizeof(num_t), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (cells == MAP_FAILED) return 0;
+
+    ram->cells = (num_t *) cells;
+    ram->size = size;
+    ram->fileBacked = false;
+    ram->accesses = 0;
+    ram->bus = nullptr;
+    return 1;
+}
+
+/**
+ * Maps RAM onto a file, the file is created or extended with zeros if needed
+ * @param ram Pointer to ram_t structure
+ * @param path Path to the file
+ * @param size Number of cells, 0 to take it from the file size
+ * @return 1 if successful, 0 otherwise
+ */
+int ramMapFile(ram_t *ram, const char *path, size_t size) {
+    assert(ram);
+    assert(path);
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd == -1) return 0;
+
+    struct stat info = {};
+    if (fstat(fd, &info) == -1) {
+        close(fd);
+        return 0;
+    }
+    if (size == 0)
+        size = info.st_size / sizeof(num_t);
+    if (size == 0)
+        size = DEFAULT_RAM_SIZE;
+
+    if ((size > MAX_RAM_SIZE) || (((size_t) info.st_size < size * sizeof(num_t)) && (ftruncate(fd, size * sizeof(num_t)) == -1))) {
+        close(fd);
+        return 0;
+    }
+
+    void *cells = mmap(nullptr, size * sizeof(num_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (cells == MAP_FAILED) return 0;
+
+    ram->cells = (num_t *) cells;
+    ram->size = size;
+    ram->fileBacked = true;
+    ram->accesses = 0;
+    ram->bus = nullptr;
+    return 1;
+}
+
+/**
+ * Flushes file-backed RAM to the file
+ * @param ram Pointer to ram_t structure
+ * @return 1 if successful or RAM is anonymous, 0 otherwise
+ */
+int ramSync(ram_t *ram) {
+    assert(ram);
+
+    if (!ram->fileBacked) return 1;
+    return msync(ram->cells, ram->size * sizeof(num_t), MS_SYNC) == 0;
+}
+
+int ramDestruct(ram_t *ram) {
+    assert(ram);
+
+    if (!ram->cells) return 0;
+    ramSync(ram);
+    munmap(ram->cells, ram->size * sizeof(num_t));
+    ram->cells = nullptr;
+    ram->size = 0;
+    return 1;
+}
+
+num_t getNumFromRAM(ram_t *ram, size_t n) {
+    assert(ram);
+    if (n >= ram->size) {
+        size_t offset = 0;
+        const device_t *device = ram->bus ? busFind(ram->bus, (long long) n, &offset) : nullptr;
+        if (!device) {
+            printf(ANSI_COLOR_RED "Accessing non-existing RAM adress! Terminating...\n" ANSI_COLOR_RESET);
+            exit(-1);
+        }
+        return device->read ? device->read(device->context, offset) : 0;
+    }
+    ram->accesses++;
+    return ram->cells[n];
+}
+
+void setNumToRAM(ram_t *ram, size_t n, num_t val) {
+    assert(ram);
+    if (n >= ram->size) {
+        size_t offset = 0;
+        const device_t *device = ram->bus ? busFind(ram->bus, (long long) n, &offset) : nullptr;
+        if (!device) {
+            printf(ANSI_COLOR_RED "Accessing non-existing RAM adress! Terminating...\n" ANSI_COLOR_RESET);
+            exit(-1);
+        }
+        if (device->write) device->write(device->context, offset, val);
+        return;
+    }
+    ram->accesses++;
+    ram->cells[n] = val;
+}
+
+/**
+ * Checks the whole block once so that block operations can work on raw cells.
+ * Every cell of the block counts as one access.
+ * @param ram Pointer to ram_t structure
+ * @param n First cell
+ * @param count Number of cells
+ * @return Pointer to the first cell
+ */
+num_t *getRAMBlock(ram_t *ram, size_t n, size_t count) {
+    assert(ram);
+    if ((n > ram->size) || (count > ram->size - n)) {
+        printf(ANSI_COLOR_RED "Accessing non-existing RAM block [%zu, %zu)! Terminating...\n" ANSI_COLOR_RESET, n, n + count);
+        exit(-1);
+    }
+    ram->accesses += count;
+    return ram->cells + n;
+}
@@ -0,0 +1,42 @@
+#include <stdlib.h>
+#include <limits.h>
+#include "../numeric.h"
+#include "bus.h"
+
+#ifndef CPU_RAM_H
+#define CPU_RAM_H
+
+const size_t DEFAULT_RAM_SIZE = 1024;
+
+// Addresses are int everywhere (immediates, index registers, numToInt of registers), cells above INT_MAX are unreachable
+const size_t MAX_RAM_SIZE = (size_t) INT_MAX + 1;
+
+/**
+ * VM memory of size num_t cells. The whole range is reserved up front, pages are committed by the OS on first touch.
+ * File-backed RAM is mapped shared, so its contents persist between runs.
+ * Accesses counts cells read or written by the VM for performance counters.
+ * Single-cell accesses to negative addresses in the device window go to the bus, block accesses do not.
+ */
+struct ram_t {
+    num_t *cells;
+    size_t size;
+    bool fileBacked;
+    unsigned long long accesses;
+    const bus_t *bus;
+};
+
+int ramConstruct(ram_t *ram, size_t size);
+
+int ramMapFile(ram_t *ram, const char *path, size_t size);
+
+int ramSync(ram_t *ram);
+
+int ramDestruct(ram_t *ram);
+
+num_t getNumFromRAM(ram_t *ram, size_t n);
+
+void setNumToRAM(ram_t *ram, size_t n, num_t val);
+
+num_t *getRAMBlock(ram_t *ram, size_t n, size_t count);
+
+#endif //CPU_RAM_H
@@ -0,0 +1,149 @@
+#include "render.h"
+#include <assert.h>
+#include <string.h>
+
+#define ANSI_COLOR_RESET "\x1b[0m"
+#define ANSI_BGCOLOR_DUMMY "\x1b[%dm  "
+#define ANSI_HALFBLOCK_DUMMY "\x1b[%d;%dm"
+#define UPPER_HALF_BLOCK "\xe2\x96\x80"
+
+#define SIXEL_BEGIN "\x1bPq"
+#define SIXEL_END "\x1b\\"
+
+// SGR codes of normal and bright foreground colors, background ones are 10 more
+const int ANSI_FOREGROUND = 30;
+const int ANSI_BRIGHT_FOREGROUND = 90;
+const int ANSI_BACKGROUND_OFFSET = 10;
+
+const int SIXEL_PALETTE[RENDER_COLORS_NUM][3] = {{0,   0,   0},
+                                                 {80,  0,   0},
+                                                 {0,   80,  0},
+                                                 {80,  80,  0},
+                                                 {0,   0,   80},
+                                                 {80,  0,   80},
+                                                 {0,   80,  80},
+                                                 {90,  90,  90},
+                                                 {50,  50,  50},
+                                                 {100, 30,  30},
+                                                 {30,  100, 30},
+                                                 {100, 100, 30},
+                                                 {30,  30,  100},
+                                                 {100, 30,  100},
+                                                 {30,  100, 100},
+                                                 {100, 100, 100}};
+
+static int renderColor(char color) {
+    return (unsigned char) color % RENDER_COLORS_NUM;
+}
+
+static int ansiForeground(int color) {
+    return (color < RENDER_COLORS_NUM / 2) ? ANSI_FOREGROUND + color
+                                           : ANSI_BRIGHT_FOREGROUND + color - RENDER_COLORS_NUM / 2;
+}
+
+const renderer_t DEFAULT_RENDERERS[] = {{"ansi",      renderAnsi},
+                                        {"halfblock", renderHalfBlock},
+                                        {"sixel",     renderSixel},
+                                        {nullptr,     nullptr}};
+
+/**
+ * Original backend: two spaces with background color per pixel
+ */
+void renderAnsi(FILE *out, const char *VRAM, size_t width, size_t height) {
+    assert(out);
+    assert(VRAM);
+
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            fprintf(out, ANSI_BGCOLOR_DUMMY ANSI_COLOR_RESET, ansiForeground(renderColor(VRAM[y * width + x])) + ANSI_BACKGROUND_OFFSET);
+        }
+        fputc('\n', out);
+    }
+}
+
+/**
+ * Packs two pixel rows into one character cell: foreground colors the upper half, background the lower one.
+ * Color escape is emitted only when the pair of colors changes.
+ */
+void renderHalfBlock(FILE *out, const char *VRAM, size_t width, size_t height) {
+    assert(out);
+    assert(VRAM);
+
+    for (size_t y = 0; y < height; y += 2) {
+        int fg = -1;
+        int bg = -1;
+        for (size_t x = 0; x < width; x++) {
+            int top = renderColor(VRAM[y * width + x]);
+            int bottom = (y + 1 < height) ? renderColor(VRAM[(y + 1) * width + x]) : 0;
+            if ((top != fg) || (bottom != bg)) {
+                fprintf(out, ANSI_HALFBLOCK_DUMMY, ansiForeground(top), ansiForeground(bottom) + ANSI_BACKGROUND_OFFSET);
+                fg = top;
+                bg = bottom;
+            }
+            fputs(UPPER_HALF_BLOCK, out);
+        }
+        fputs(ANSI_COLOR_RESET "\n", out);
+    }
+}
+
+/**
+ * Emits run of count equal sixels using the repeat introducer where it is shorter
+ */
+static void putSixelRun(FILE *out, char sixel, size_t count) {
+    if (count > 3) {
+        fprintf(out, "!%zu%c", count, sixel);
+    } else {
+        for (size_t i = 0; i < count; i++)
+            fputc(sixel, out);
+    }
+}
+
+/**
+ * Sixel image where every pixel is SIXEL_SCALE dots wide and high, so each pixel row is exactly one sixel band.
+ * Every color of the row is drawn as run-length encoded runs of full and empty sixels.
+ */
+void renderSixel(FILE *out, const char *VRAM, size_t width, size_t height) {
+    assert(out);
+    assert(VRAM);
+
+    fprintf(out, SIXEL_BEGIN "\"1;1;%zu;%zu", width * SIXEL_SCALE, height * SIXEL_SCALE);
+    for (int c = 0; c < RENDER_COLORS_NUM; c++)
+        fprintf(out, "#%d;2;%d;%d;%d", c, SIXEL_PALETTE[c][0], SIXEL_PALETTE[c][1], SIXEL_PALETTE[c][2]);
+
+    for (size_t y = 0; y < height; y++) {
+        const char *row = VRAM + y * width;
+        bool firstColor = true;
+        for (int c = 0; c < RENDER_COLORS_NUM; c++) {
+            size_t first = 0;
+            while ((first < width) && (renderColor(row[first]) != c))
+                first++;
+            if (first == width) continue;
+            if (!firstColor) fputc('$', out);
+            firstColor = false;
+            fprintf(out, "#%d", c);
+
+            size_t x = 0;
+            while (x < width) {
+                bool set = renderColor(row[x]) == c;
+                size_t run = 1;
+                while ((x + run < width) && ((renderColor(row[x + run]) == c) == set))
+                    run++;
+                if (set || (x + run < width))
+                    putSixelRun(out, set ? '~' : '?', run * SIXEL_SCALE);
+                x += run;
+            }
+        }
+        fputc('-', out);
+    }
+    fputs(SIXEL_END "\n", out);
+}
+
+const renderer_t *findRenderer(const char *name) {
+    assert(name);
+
+    for (const renderer_t *renderer = DEFAULT_RENDERERS; renderer->name; renderer++)
+        if (strcmp(renderer->name, name) == 0)
+            return renderer;
+
+    return nullptr;
+}
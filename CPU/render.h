@@ -0,0 +1,31 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifndef CPU_RENDER_H
+#define CPU_RENDER_H
+
+const size_t SIXEL_SCALE = 6;
+
+// Colors are the 16 terminal colors, 8..15 are the bright ones. Other values are wrapped into this range.
+const int RENDER_COLORS_NUM = 16;
+
+/**
+ * Terminal render backend: turns VRAM of color indices into the frame written to out
+ */
+struct renderer_t {
+    const char *name;
+
+    void (*render)(FILE *out, const char *VRAM, size_t width, size_t height);
+};
+
+void renderAnsi(FILE *out, const char *VRAM, size_t width, size_t height);
+
+void renderHalfBlock(FILE *out, const char *VRAM, size_t width, size_t height);
+
+void renderSixel(FILE *out, const char *VRAM, size_t width, size_t height);
+
+const renderer_t *findRenderer(const char *name);
+
+extern const renderer_t DEFAULT_RENDERERS[];
+
+#endif //CPU_RENDER_H
@@ -0,0 +1,218 @@
+#include "snapshot.h"
+#include "MurMurHash3.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static bool isZeroPage(const num_t *cells, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        if (cells[i]) return false;
+    return true;
+}
+
+/**
+ * Creates uniquely named temporary file next to path, so concurrent writers never share it
+ * @param writer Writer to initialize
+ * @param path Snapshot path
+ * @return 1 if successful, 0 otherwise
+ */
+int snapshotBegin(snapshot_writer_t *writer, const char *path) {
+    assert(writer);
+    assert(path);
+
+    const char suffix[] = ".XXXXXX";
+    writer->path = path;
+    writer->tmpPath = (char *) calloc(strlen(path) + sizeof(suffix), sizeof(char));
+    writer->buffer = (char *) calloc(SNAPSHOT_BUFFER_SIZE, sizeof(char));
+    writer->file = nullptr;
+    if (!writer->tmpPath || !writer->buffer) {
+        snapshotEnd(writer);
+        return 0;
+    }
+    strcpy(writer->tmpPath, path);
+    strcat(writer->tmpPath, suffix);
+
+    int fd = mkstemp(writer->tmpPath);
+    if (fd == -1) {
+        snapshotEnd(writer);
+        return 0;
+    }
+    writer->file = fdopen(fd, "wb");
+    if (!writer->file) {
+        close(fd);
+        unlink(writer->tmpPath);
+        snapshotEnd(writer);
+        return 0;
+    }
+    setvbuf(writer->file, writer->buffer, _IOFBF, SNAPSHOT_BUFFER_SIZE);
+    return 1;
+}
+
+/**
+ * Writes machine state to the temporary file and renames it over the snapshot path.
+ * Does not allocate memory and does not close the file, the temporary file is removed on failure.
+ * @param writer Writer prepared by snapshotBegin
+ * @param cpu Machine state
+ * @param bin Program being executed
+ * @param len Program length
+ * @param pc Offset of the instruction to resume from
+ * @return 1 if successful, 0 otherwise
+ */
+int snapshotWrite(snapshot_writer_t *writer, cpu_t *cpu, const char *bin, int len, int pc) {
+    assert(writer);
+    assert(writer->file);
+    assert(cpu);
+    assert(bin);
+
+    snapshot_header_t header = {};
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.numericModel = NUMERIC_MODEL_ID;
+    header.programHash = MurMurHash3_32(bin, len, SNAPSHOT_MAGIC);
+    header.programLength = len;
+    header.pc = pc;
+    memcpy(header.registers, cpu->registers, sizeof(header.registers));
+    memcpy(header.indexes, cpu->indexes, sizeof(header.indexes));
+    header.flags = cpu->flags;
+    header.display = cpu->display;
+    header.stackSize = cpu->stk.size;
+    header.callDepth = cpu->callDepth;
+    header.bp = cpu->bp;
+    header.frameTop = cpu->frameTop;
+    header.ramSize = cpu->ram.size;
+    header.vramSize = WIDTH * HEIGHT;
+
+    FILE *f = writer->file;
+    fwrite(&header, sizeof(header), 1, f);
+    for (size_t depth = header.stackSize; depth > 0; depth--) {
+        elem_t value = 0;
+        stackPeek(&cpu->stk, depth - 1, &value);
+        fwrite(&value, sizeof(value), 1, f);
+    }
+    fwrite(cpu->calls, sizeof(int), header.callDepth, f);
+    fwrite(cpu->frames, sizeof(num_t), header.frameTop, f);
+
+    for (size_t page = 0; page * SNAPSHOT_PAGE_CELLS < cpu->ram.size; page++) {
+        const num_t *cells = cpu->ram.cells + page * SNAPSHOT_PAGE_CELLS;
+        size_t count = cpu->ram.size - page * SNAPSHOT_PAGE_CELLS;
+        if (count > SNAPSHOT_PAGE_CELLS) count = SNAPSHOT_PAGE_CELLS;
+        if (isZeroPage(cells, count)) continue;
+        fwrite(&page, sizeof(page), 1, f);
+        fwrite(cells, sizeof(num_t), count, f);
+    }
+    fwrite(&SNAPSHOT_LAST_PAGE, sizeof(SNAPSHOT_LAST_PAGE), 1, f);
+    fwrite(cpu->VRAM, sizeof(char), header.vramSize, f);
+
+    bool ok = (fflush(f) == 0) && !ferror(f);
+    ok = ok && (rename(writer->tmpPath, writer->path) == 0);
+    if (!ok) unlink(writer->tmpPath);
+    return ok;
+}
+
+// Closes this process's copy of the file and frees the writer
+void snapshotEnd(snapshot_writer_t *writer) {
+    assert(writer);
+
+    if (writer->file) fclose(writer->file);
+    free(writer->tmpPath);
+    free(writer->buffer);
+    writer->file = nullptr;
+    writer->tmpPath = nullptr;
+    writer->buffer = nullptr;
+}
+
+/**
+ * Writes machine state to path atomically: snapshot is written to a temporary file which is then renamed
+ * @param path Snapshot path
+ * @param cpu Machine state
+ * @param bin Program being executed
+ * @param len Program length
+ * @param pc Offset of the instruction to resume from
+ * @return 1 if successful, 0 otherwise
+ */
+int snapshotSave(const char *path, cpu_t *cpu, const char *bin, int len, int pc) {
+    snapshot_writer_t writer = {};
+    if (!snapshotBegin(&writer, path)) return 0;
+    int ok = snapshotWrite(&writer, cpu, bin, len, pc);
+    snapshotEnd(&writer);
+    return ok;
+}
+
+/**
+ * Restores machine state saved by snapshotSave. Stack and VRAM must be constructed,
+ * RAM is allocated with the snapshot's size unless it is already mapped.
+ * @param path Snapshot path
+ * @param cpu Machine state
+ * @param bin Program being executed, must be the one snapshot was taken from
+ * @param len Program length
+ * @param pc Where to put offset of the instruction to resume from
+ * @return 1 if successful, 0 otherwise
+ */
+int snapshotLoad(const char *path, cpu_t *cpu, const char *bin, int len, int *pc) {
+    assert(path);
+    assert(cpu);
+    assert(bin);
+    assert(pc);
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+
+    snapshot_header_t header = {};
+    if ((fread(&header, sizeof(header), 1, f) != 1) || (header.magic != SNAPSHOT_MAGIC) ||
+        (header.version != SNAPSHOT_VERSION) || (header.numericModel != NUMERIC_MODEL_ID) || (header.programLength != len) ||
+        (header.programHash != MurMurHash3_32(bin, len, SNAPSHOT_MAGIC)) || (header.vramSize != WIDTH * HEIGHT) ||
+        (header.pc < 0) || (header.pc > len) || (header.callDepth < 0) || (header.callDepth > CALL_STACK_DEPTH) ||
+        (header.frameTop < 0) || (header.frameTop > FRAME_REGION_SIZE) || (header.bp < 0) || (header.bp > header.frameTop)) {
+        fclose(f);
+        return 0;
+    }
+
+    if (!cpu->ram.cells && !ramConstruct(&cpu->ram, header.ramSize)) {
+        fclose(f);
+        return 0;
+    }
+    if (cpu->ram.size != header.ramSize) {
+        fclose(f);
+        return 0;
+    }
+    if (cpu->ram.fileBacked)
+        memset(cpu->ram.cells, 0, cpu->ram.size * sizeof(num_t));
+
+    *pc = header.pc;
+    memcpy(cpu->registers, header.registers, sizeof(header.registers));
+    memcpy(cpu->indexes, header.indexes, sizeof(header.indexes));
+    cpu->flags = header.flags;
+    cpu->display = header.display;
+
+    bool ok = true;
+    for (size_t i = 0; ok && (i < header.stackSize); i++) {
+        elem_t value = 0;
+        ok = (fread(&value, sizeof(value), 1, f) == 1) && stackPush(&cpu->stk, value);
+    }
+
+    cpu->callDepth = header.callDepth;
+    ok = ok && (fread(cpu->calls, sizeof(int), header.callDepth, f) == (size_t) header.callDepth);
+    for (int i = 0; ok && (i < header.callDepth); i++)
+        ok = (cpu->calls[i] >= 0) && (cpu->calls[i] < len);
+
+    cpu->bp = header.bp;
+    cpu->frameTop = header.frameTop;
+    ok = ok && (fread(cpu->frames, sizeof(num_t), header.frameTop, f) == (size_t) header.frameTop);
+
+    size_t page = 0;
+    while (ok && (fread(&page, sizeof(page), 1, f) == 1) && (page != SNAPSHOT_LAST_PAGE)) {
+        if (page >= (header.ramSize + SNAPSHOT_PAGE_CELLS - 1) / SNAPSHOT_PAGE_CELLS) {
+            ok = false;
+            break;
+        }
+        size_t count = header.ramSize - page * SNAPSHOT_PAGE_CELLS;
+        if (count > SNAPSHOT_PAGE_CELLS) count = SNAPSHOT_PAGE_CELLS;
+        ok = fread(cpu->ram.cells + page * SNAPSHOT_PAGE_CELLS, sizeof(num_t), count, f) == count;
+    }
+    ok = ok && (page == SNAPSHOT_LAST_PAGE);
+    ok = ok && (fread(cpu->VRAM, sizeof(char), header.vramSize, f) == header.vramSize);
+
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,63 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "cpu.h"
+
+#ifndef CPU_SNAPSHOT_H
+#define CPU_SNAPSHOT_H
+
+const unsigned int SNAPSHOT_MAGIC = 0x50414E53; // "SNAP"
+
+const unsigned int SNAPSHOT_VERSION = 6;
+
+const size_t SNAPSHOT_PAGE_CELLS = 1024;
+
+const size_t SNAPSHOT_LAST_PAGE = (size_t) -1;
+
+const size_t SNAPSHOT_BUFFER_SIZE = 1 << 16;
+
+/**
+ * Snapshot starts with this header, followed by stack elements from the bottom, return addresses from the bottom,
+ * used part of the frame region,
+ * non-zero RAM pages as (page index, SNAPSHOT_PAGE_CELLS cells) terminated by SNAPSHOT_LAST_PAGE, and VRAM.
+ */
+struct snapshot_header_t {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int numericModel;
+    unsigned long programHash;
+    int programLength;
+    int pc;
+    num_t registers[REGS_NUM];
+    int indexes[INDEX_REGS_NUM];
+    int flags;
+    display_t display;
+    size_t stackSize;
+    int callDepth;
+    int bp;
+    int frameTop;
+    size_t ramSize;
+    size_t vramSize;
+};
+
+/**
+ * Snapshot being written. Everything that allocates happens in snapshotBegin and snapshotEnd,
+ * so snapshotWrite is safe to call in a child forked from a multithreaded VM.
+ */
+struct snapshot_writer_t {
+    const char *path;
+    char *tmpPath;
+    FILE *file;
+    char *buffer;
+};
+
+int snapshotBegin(snapshot_writer_t *writer, const char *path);
+
+int snapshotWrite(snapshot_writer_t *writer, cpu_t *cpu, const char *bin, int len, int pc);
+
+void snapshotEnd(snapshot_writer_t *writer);
+
+int snapshotSave(const char *path, cpu_t *cpu, const char *bin, int len, int pc);
+
+int snapshotLoad(const char *path, cpu_t *cpu, const char *bin, int len, int *pc);
+
+#endif //CPU_SNAPSHOT_H
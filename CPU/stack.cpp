@@ -6,7 +6,6 @@
 #include "MurMurHash3.h"
 #include <assert.h>
 #include <string.h>
-#include <wchar.h>
 
 #define ANSI_COLOR_RED "\x1b[31m"
 #define ANSI_COLOR_GREEN "\x1b[32m"
@@ -130,6 +129,79 @@ int stackPop(stack_t *stack, elem_t *destination) {
     return 1;
 }
 
+/**
+ * Function that reads element without removing it
+ * @param stack Pointer to stack
+ * @param depth Distance from the top of the stack, 0 is the top element
+ * @param destination Where to put stack element
+ * @return 1 if successful, 0 if there is no such element
+ */
+
+int stackPeek(stack_t *stack, size_t depth, elem_t *destination) {
+    assert(stack);
+    assert(destination);
+
+    checkStackValidity(stack);
+
+    if (depth >= stack->size) return 0;
+
+#ifdef USE_CANARIES
+    *destination = stack->data[CANARY_STACK_SIZE + stack->size - 1 - depth];
+#else
+    *destination = stack->data[stack->size - 1 - depth];
+#endif
+
+    return 1;
+}
+
+/**
+ * Function that pushes copy of the element at given depth, e.g. depth 0 duplicates the top element
+ * @param stack Pointer to stack
+ * @param depth Distance from the top of the stack
+ * @return 1 if successful, 0 if there is no such element or allocation error happened
+ */
+
+int stackPick(stack_t *stack, size_t depth) {
+    assert(stack);
+
+    elem_t element = 0;
+    if (!stackPeek(stack, depth, &element)) return 0;
+
+    return stackPush(stack, element);
+}
+
+/**
+ * Function that moves the element at given depth to the top, elements above it are shifted down in place
+ * @param stack Pointer to stack
+ * @param depth Distance from the top of the stack, 1 swaps two top elements
+ * @return 1 if successful, 0 if there is no such element
+ */
+
+int stackRotate(stack_t *stack, size_t depth) {
+    assert(stack);
+
+    checkStackValidity(stack);
+
+    if (depth >= stack->size) return 0;
+
+#ifdef USE_CANARIES
+    elem_t *top = stack->data + CANARY_STACK_SIZE + stack->size - 1;
+#else
+    elem_t *top = stack->data + stack->size - 1;
+#endif
+    elem_t element = *(top - depth);
+    memmove(top - depth, top - depth + 1, depth * sizeof(elem_t));
+    *top = element;
+
+#ifdef USE_HASH
+    updateHashes(stack);
+#endif
+
+    checkStackValidity(stack);
+
+    return 1;
+}
+
 /**
  * Function that extends stack
  * @param stack Pointer to stack
@@ -152,13 +224,11 @@ int stackExtend(stack_t *stack) {
     else {
         stack->data = newPointer;
 #ifdef USE_CANARIES
-        wmemset((wchar_t *) (stack->data + stack->maxsize + CANARY_STACK_SIZE), (wchar_t) (DEFAULT_POISON),
-                (newSize - stack->maxsize) * sizeof(elem_t) / sizeof(wchar_t));
-
-//        wmemset((wchar_t *) (stack->data + stack->maxsize), (wchar_t) (DEFAULT_POISON),
-//                (newSize - stack->maxsize) * sizeof(elem_t) / sizeof(wchar_t));
+        for (size_t i = stack->maxsize; i < newSize; i++)
+            stack->data[i + CANARY_STACK_SIZE] = DEFAULT_POISON;
 #else
-        wmemset((wchar_t *)(stack->data + stack->maxsize), (wchar_t)(DEFAULT_POISON), (newSize - stack->maxsize) * sizeof(elem_t) / sizeof(wchar_t));
+        for (size_t i = stack->maxsize; i < newSize; i++)
+            stack->data[i] = DEFAULT_POISON;
 #endif
         stack->maxsize = newSize;
 
@@ -288,7 +358,7 @@ int stackDump(FILE *f, stack_t *stack, const char *prompt, bool colored) {
 
     fprintf(f, "%s\n", prompt);
     fprintf(f, "stack_t %s [%p] {\n", stack->stackName, stack);
-    fprintf(f, "    size = %zu;\n    poison = %d;\n", stack->size, stack->poisonValue);
+    fprintf(f, "    size = %zu;\n    poison = %lg;\n", stack->size, (double) stack->poisonValue);
 
 #ifdef USE_HASH
     fprintf(f, "    structHash = %lu;\n    stackHash = %lu;\n", stack->structHash, stack->stackHash);
@@ -313,7 +383,7 @@ int stackDump(FILE *f, stack_t *stack, const char *prompt, bool colored) {
             if (colored) fprintf(f, ANSI_COLOR_YELLOW);
             customCh = ' ';
         }
-        fprintf(f, "      %c [%zu] = %d", customCh, i - offset, stack->data[i]);
+        fprintf(f, "      %c [%zu] = %lg", customCh, i - offset, (double) stack->data[i]);
         if (stack->data[i] == stack->poisonValue)
             fprintf(f, " [POISON]\n" ANSI_COLOR_RESET);
         else
@@ -4,6 +4,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include "../numeric.h"
 
 #ifndef STACK_STACK_H
 #define STACK_STACK_H
@@ -14,7 +15,7 @@
 
 #define USE_HASH
 
-typedef int elem_t;
+typedef num_t elem_t;
 
 const size_t DEFAULT_INIT_SIZE = 16;
 
@@ -68,6 +69,12 @@ int stackPush(stack_t *stack, elem_t element);
 
 int stackPop(stack_t *stack, elem_t *destination);
 
+int stackPeek(stack_t *stack, size_t depth, elem_t *destination);
+
+int stackPick(stack_t *stack, size_t depth);
+
+int stackRotate(stack_t *stack, size_t depth);
+
 int stackExtend(stack_t *stack);
 
 int stackOk(stack_t stack);
@@ -0,0 +1,95 @@
+#include "vector.h"
+#include <assert.h>
+
+// Every kernel is compiled for AVX2 and for the baseline ISA, the loader picks one by CPUID on startup
+#if defined(__x86_64__)
+#define VECTOR_KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+#define VECTOR_KERNEL
+#endif
+
+// Products and sums are accumulated wider than num_t and rescaled once
+#if defined(NUMERIC_DOUBLE)
+typedef double wide_t;
+#else
+typedef long long wide_t;
+#endif
+
+static inline num_t rescale(wide_t product) {
+#if defined(NUMERIC_Q16)
+    return (num_t) (product >> NUM_FRACTION_BITS);
+#else
+    return (num_t) (product / NUM_ONE);
+#endif
+}
+
+VECTOR_KERNEL
+void vectorAdd(num_t *dst, const num_t *a, const num_t *b, size_t count) {
+    assert(dst);
+    assert(a);
+    assert(b);
+
+    for (size_t i = 0; i < count; i++)
+        dst[i] = a[i] + b[i];
+}
+
+VECTOR_KERNEL
+void vectorSub(num_t *dst, const num_t *a, const num_t *b, size_t count) {
+    assert(dst);
+    assert(a);
+    assert(b);
+
+    for (size_t i = 0; i < count; i++)
+        dst[i] = a[i] - b[i];
+}
+
+VECTOR_KERNEL
+void vectorMul(num_t *dst, const num_t *a, const num_t *b, size_t count) {
+    assert(dst);
+    assert(a);
+    assert(b);
+
+    for (size_t i = 0; i < count; i++)
+        dst[i] = rescale((wide_t) a[i] * b[i]);
+}
+
+VECTOR_KERNEL
+void vectorMin(num_t *dst, const num_t *a, const num_t *b, size_t count) {
+    assert(dst);
+    assert(a);
+    assert(b);
+
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (a[i] < b[i]) ? a[i] : b[i];
+}
+
+VECTOR_KERNEL
+void vectorMax(num_t *dst, const num_t *a, const num_t *b, size_t count) {
+    assert(dst);
+    assert(a);
+    assert(b);
+
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (a[i] > b[i]) ? a[i] : b[i];
+}
+
+VECTOR_KERNEL
+num_t vectorDot(const num_t *a, const num_t *b, size_t count) {
+    assert(a);
+    assert(b);
+
+    wide_t sum = 0;
+    for (size_t i = 0; i < count; i++)
+        sum += (wide_t) a[i] * b[i];
+    return rescale(sum);
+}
+
+VECTOR_KERNEL
+num_t vectorSum(const num_t *a, size_t count) {
+    assert(a);
+
+    wide_t sum = 0;
+    for (size_t i = 0; i < count; i++)
+        sum += a[i];
+    return (num_t) sum;
+}
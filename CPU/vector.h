@@ -0,0 +1,22 @@
+#include <stdlib.h>
+#include "../numeric.h"
+
+#ifndef CPU_VECTOR_H
+#define CPU_VECTOR_H
+
+// Element-wise kernels, dst may be the same range as a or b
+void vectorAdd(num_t *dst, const num_t *a, const num_t *b, size_t count);
+
+void vectorSub(num_t *dst, const num_t *a, const num_t *b, size_t count);
+
+void vectorMul(num_t *dst, const num_t *a, const num_t *b, size_t count);
+
+void vectorMin(num_t *dst, const num_t *a, const num_t *b, size_t count);
+
+void vectorMax(num_t *dst, const num_t *a, const num_t *b, size_t count);
+
+num_t vectorDot(const num_t *a, const num_t *b, size_t count);
+
+num_t vectorSum(const num_t *a, size_t count);
+
+#endif //CPU_VECTOR_H
@@ -0,0 +1,55 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "framebuffer.h"
+#include "render.h"
+
+#define ANSI_COLOR_RED "\x1b[31m"
+#define ANSI_COLOR_RESET "\x1b[0m"
+
+const int FRAME_TIMEOUT = 20;
+
+const char *defaultRenderer = "halfblock";
+
+int main(int argc, char *argv[]) {
+    const renderer_t *renderer = findRenderer(defaultRenderer);
+
+    int option = 0;
+    while ((option = getopt(argc, argv, "r:")) != -1) {
+        if ((option != 'r') || !(renderer = findRenderer(optarg))) {
+            printf(ANSI_COLOR_RED "Usage: %s [-r ansi|halfblock|sixel] name. Terminating...\n" ANSI_COLOR_RESET, argv[0]);
+            return -1;
+        }
+    }
+    if (optind + 1 != argc) {
+        printf(ANSI_COLOR_RED "Framebuffer name is not specified. Terminating...\n" ANSI_COLOR_RESET);
+        return -1;
+    }
+
+    framebuffer_t fb = {};
+    if (!framebufferOpen(&fb, argv[optind])) {
+        printf(ANSI_COLOR_RED "Unable to open framebuffer %s. Terminating...\n" ANSI_COLOR_RESET, argv[optind]);
+        return -1;
+    }
+
+    size_t width = fb.header->width;
+    size_t height = fb.header->height;
+    auto frame = (char *) calloc(width * height, sizeof(char));
+    unsigned long long sequence = 0;
+
+    while (true) {
+        bool alive = framebufferAlive(&fb);
+        if (framebufferRead(&fb, frame, &sequence)) {
+            printf("\033[1;1H");
+            renderer->render(stdout, frame, width, height);
+            fflush(stdout);
+        }
+        if (!alive) break;
+        framebufferWait(&fb, FRAME_TIMEOUT);
+    }
+
+    framebufferClose(&fb);
+    free(frame);
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <stdlib.h>
+
+#ifndef CPU_VMAPI_H
+#define CPU_VMAPI_H
+
+#ifdef __cplusplus
+#include "../numeric.h"
+#else
+// numeric.h is C++, C plugins get the same num_t and model ids from the NUMERIC_* definition they are built with
+#if defined(NUMERIC_DOUBLE)
+typedef double num_t;
+#define NUMERIC_MODEL_ID 2
+#elif defined(NUMERIC_INT64)
+typedef long long num_t;
+#define NUMERIC_MODEL_ID 1
+#elif defined(NUMERIC_Q16)
+typedef int num_t;
+#define NUMERIC_MODEL_ID 3
+#else
+typedef int num_t;
+#define NUMERIC_MODEL_ID 0
+#endif
+#endif
+
+// Interface between the VM and native functions called with "sys n".
+// It is a C ABI: plugins get every VM service through vm_api_t, so they do not link against the VM.
+// Values are num_t of the VM's numeric model, plugins have to check numericModel before registering.
+
+#define VM_API_VERSION 1
+
+#define VM_PLUGIN_INIT "vmPluginInit"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct vm_t vm_t;
+
+typedef struct vm_api_t vm_api_t;
+
+// Returns nonzero on success, zero terminates the VM
+typedef int (*vm_native_t)(vm_t *vm, const vm_api_t *api);
+
+struct vm_api_t {
+    unsigned int version;
+    unsigned int numericModel;
+    num_t one;
+
+    // Stack, return zero on underflow or overflow
+    int (*pop)(vm_t *vm, num_t *value);
+    int (*push)(vm_t *vm, num_t value);
+    int (*peek)(vm_t *vm, size_t depth, num_t *value);
+
+    // General register, nullptr if there is no such register
+    num_t *(*reg)(vm_t *vm, int n);
+
+    // Block of count cells at address, nullptr if it does not fit into RAM
+    num_t *(*ram)(vm_t *vm, size_t address, size_t count);
+    size_t (*ramSize)(vm_t *vm);
+
+    // Binds "sys n" to native, returns zero if n is out of range or already taken
+    int (*registerNative)(vm_t *vm, int n, const char *name, vm_native_t native);
+};
+
+// Entry point exported by plugins under the name VM_PLUGIN_INIT, returns zero if the plugin can not be used
+typedef int (*vm_plugin_init_t)(vm_t *vm, const vm_api_t *api);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CPU_VMAPI_H
@@ -9,104 +9,236 @@ DEF_CMD(NOP, 0, 0, {})*/
 
 #define GET_INT_ARG arg = *((int *)(bin + 1)); bin += sizeof(int);
 
+#define GET_REG_ARG GET_INT_ARG \
+            if((arg < 0) || (arg >= REGS_NUM)) { \
+                printf(ANSI_COLOR_RED "Invalid register number %d. Terminating..." ANSI_COLOR_RESET, arg); \
+                return 0; \
+            }
+
+#define GET_FRAME_ARG GET_INT_ARG \
+            arg += bp; \
+            if((arg < bp) || (arg >= frameTop)) { \
+                printf(ANSI_COLOR_RED "Frame access [bp%+d] outside of the current frame. Terminating..." ANSI_COLOR_RESET, arg - bp); \
+                return 0; \
+            }
+
+#define GET_INDEX_ARG GET_INT_ARG \
+            if((arg < 0) || (arg >= INDEX_REGS_NUM)) { \
+                printf(ANSI_COLOR_RED "Invalid index register number %d. Terminating..." ANSI_COLOR_RESET, arg); \
+                return 0; \
+            }
+
 DEF_CMD(push, 1,
-        CMD_OVRLD(1, isdigit(*sarg)  || (*sarg == '-'), NUMBER, {
+        CMD_OVRLD(1, isdigit(*sarg)  || (*sarg == '-'), FIXED, {
             GET_INT_ARG
-            arg *= precision;
-            push(&stk, arg);
+            push(&stk, numFromImmediate(arg));
         })
-        CMD_OVRLD(11, isalpha(*sarg), REGISTER, {
+        CMD_OVRLD(107, isalpha(*sarg) && (parseRegister(sarg) == -1), LABEL, {
             GET_INT_ARG
-            if(arg >= 4) {
-                printf(ANSI_COLOR_RED "Invalid register number %d. Terminating..." ANSI_COLOR_RESET, arg);
-                return 0;
-            }
+            push(&stk, numFromInt(arg));
+        })
+        CMD_OVRLD(11, isalpha(*sarg), REGISTER, {
+            GET_REG_ARG
             push(&stk, registers[arg]);
         })
-        CMD_OVRLD(41, (*sarg == '[') && isdigit(*(sarg + 1)), RAM_IMMED, {
+        CMD_OVRLD(41, (*sarg == '[') && (isdigit(*(sarg + 1)) || (*(sarg + 1) == '-')), RAM_IMMED, {
             GET_INT_ARG
-            push(&stk, getIntFromRAM(RAM, arg));
+            push(&stk, getNumFromRAM(RAM, arg));
         })
-        CMD_OVRLD(43, (*sarg == '[') && isalpha(*(sarg + 1)) && ((strchr(sarg, '-') != nullptr) || (strchr(sarg, '+') != nullptr)), RAM_REG_IMMED, {
+        CMD_OVRLD(90, isFrameOperand(sarg), RAM_FRAME, {
+            GET_FRAME_ARG
+            push(&stk, frames[arg]);
+        })
+        CMD_OVRLD(57, (*sarg == '[') && isIndexOperand(sarg) && ((strchr(sarg, '-') != nullptr) || (strchr(sarg, '+') != nullptr)), RAM_INDEX_IMMED, {
+            GET_INDEX_ARG
+            int arg2 = arg;
             GET_INT_ARG
-            if(arg >= 4) {
-                printf(ANSI_COLOR_RED "Invalid register number %d. Terminating..." ANSI_COLOR_RESET, arg);
-                return 0;
-            }
+            push(&stk, getNumFromRAM(RAM, indexes[arg2] + arg));
+        })
+        CMD_OVRLD(56, (*sarg == '[') && isIndexOperand(sarg), RAM_INDEX, {
+            GET_INDEX_ARG
+            push(&stk, getNumFromRAM(RAM, indexes[arg]));
+        })
+        CMD_OVRLD(43, (*sarg == '[') && isalpha(*(sarg + 1)) && ((strchr(sarg, '-') != nullptr) || (strchr(sarg, '+') != nullptr)), RAM_REG_IMMED, {
+            GET_REG_ARG
             int arg2 = arg;
             GET_INT_ARG
-            arg = registers[arg2] / precision + arg;
-            push(&stk, getIntFromRAM(RAM, arg));
+            arg = numToInt(registers[arg2]) + arg;
+            push(&stk, getNumFromRAM(RAM, arg));
         })
         CMD_OVRLD(42, (*sarg == '[') && isalpha(*(sarg + 1)), RAM_REG, {
-            GET_INT_ARG
-            if(arg >= 4) {
-                printf(ANSI_COLOR_RED "Invalid register number %d. Terminating..." ANSI_COLOR_RESET, arg);
-                return 0;
-            }
-            push(&stk, getIntFromRAM(RAM, registers[arg] / precision));
+            GET_REG_ARG
+            push(&stk, getNumFromRAM(RAM, numToInt(registers[arg])));
         }))
 
 DEF_CMD(pop, 1,
         CMD_OVRLD(2, isalpha(*sarg), REGISTER, {
-            GET_INT_ARG
-            if(arg >= 4) {
-                printf(ANSI_COLOR_RED "Invalid register number %d. Terminating..." ANSI_COLOR_RESET, arg);
-                return 0;
-            }
+            GET_REG_ARG
             registers[arg] = pop(&stk);
         })
-        CMD_OVRLD(52, (*sarg == '[') && isdigit(*(sarg + 1)), RAM_IMMED, {
+        CMD_OVRLD(52, (*sarg == '[') && (isdigit(*(sarg + 1)) || (*(sarg + 1) == '-')), RAM_IMMED, {
             GET_INT_ARG
-            setIntToRAM(RAM, arg, pop(&stk));
+            setNumToRAM(RAM, arg, pop(&stk));
         })
-        CMD_OVRLD(54, (*sarg == '[') && isalpha(*(sarg + 1)) && ((strchr(sarg, '-') != nullptr) || (strchr(sarg, '+') != nullptr)), RAM_REG_IMMED, {
+        CMD_OVRLD(91, isFrameOperand(sarg), RAM_FRAME, {
+            GET_FRAME_ARG
+            frames[arg] = pop(&stk);
+        })
+        CMD_OVRLD(59, (*sarg == '[') && isIndexOperand(sarg) && ((strchr(sarg, '-') != nullptr) || (strchr(sarg, '+') != nullptr)), RAM_INDEX_IMMED, {
+            GET_INDEX_ARG
+            int arg2 = arg;
             GET_INT_ARG
-            if(arg >= 4) {
-                printf(ANSI_COLOR_RED "Invalid register number %d. Terminating..." ANSI_COLOR_RESET, arg);
-                return 0;
-            }
+            setNumToRAM(RAM, indexes[arg2] + arg, pop(&stk));
+        })
+        CMD_OVRLD(58, (*sarg == '[') && isIndexOperand(sarg), RAM_INDEX, {
+            GET_INDEX_ARG
+            setNumToRAM(RAM, indexes[arg], pop(&stk));
+        })
+        CMD_OVRLD(54, (*sarg == '[') && isalpha(*(sarg + 1)) && ((strchr(sarg, '-') != nullptr) || (strchr(sarg, '+') != nullptr)), RAM_REG_IMMED, {
+            GET_REG_ARG
             int arg2 = arg;
             GET_INT_ARG
-            arg = registers[arg2] / precision + arg;
-            setIntToRAM(RAM, arg, pop(&stk));
+            arg = numToInt(registers[arg2]) + arg;
+            setNumToRAM(RAM, arg, pop(&stk));
         })
         CMD_OVRLD(53, (*sarg == '[') && isalpha(*(sarg + 1)), RAM_REG, {
-            GET_INT_ARG
-            if(arg >= 4) {
-                printf(ANSI_COLOR_RED "Invalid register number %d. Terminating..." ANSI_COLOR_RESET, arg);
-                return 0;
-            }
-            setIntToRAM(RAM, registers[arg] / precision, pop(&stk));
+            GET_REG_ARG
+            setNumToRAM(RAM, numToInt(registers[arg]), pop(&stk));
+        }))
+
+#define IS_REG_REG isalpha(*sarg) && isalpha(*sarg2)
+#define IS_REG_NUMBER isalpha(*sarg) && (isdigit(*sarg2) || (*sarg2 == '-'))
+
+// Register forms: first operand is the destination, second one is a register or an immediate.
+// Immediates of mul and div are plain integer factors, the others are values.
+#define GET_REG_REG_ARGS GET_REG_ARG int arg2 = arg; GET_REG_ARG
+#define GET_REG_NUMBER_ARGS GET_REG_ARG int arg2 = arg; GET_INT_ARG
+
+DEF_CMD(mov, 2,
+        CMD_OVRLD(64, IS_REG_REG, REG_REG, {
+            GET_REG_REG_ARGS
+            registers[arg2] = registers[arg];
+        })
+        CMD_OVRLD(65, IS_REG_NUMBER, REG_FIXED, {
+            GET_REG_NUMBER_ARGS
+            registers[arg2] = numFromImmediate(arg);
         }))
 
 DEF_CMD(add, 0,
-        CMD_OVRLD(3, true, NONE, {
+        CMD_OVRLD(66, IS_REG_REG, REG_REG, {
+            GET_REG_REG_ARGS
+            registers[arg2] += registers[arg];
+            flags = compareFlags(registers[arg2], 0);
+        })
+        CMD_OVRLD(67, IS_REG_NUMBER, REG_FIXED, {
+            GET_REG_NUMBER_ARGS
+            registers[arg2] += numFromImmediate(arg);
+            flags = compareFlags(registers[arg2], 0);
+        })
+        CMD_OVRLD(3, *sarg == '\0', NONE, {
             push(&stk, pop(&stk) + pop(&stk));
         }))
 
 DEF_CMD(sub, 0,
-        CMD_OVRLD(4, true, NONE, {
+        CMD_OVRLD(68, IS_REG_REG, REG_REG, {
+            GET_REG_REG_ARGS
+            registers[arg2] -= registers[arg];
+            flags = compareFlags(registers[arg2], 0);
+        })
+        CMD_OVRLD(69, IS_REG_NUMBER, REG_FIXED, {
+            GET_REG_NUMBER_ARGS
+            registers[arg2] -= numFromImmediate(arg);
+            flags = compareFlags(registers[arg2], 0);
+        })
+        CMD_OVRLD(4, *sarg == '\0', NONE, {
             push(&stk, pop(&stk) - pop(&stk));
         }))
 
 DEF_CMD(mul, 0,
-        CMD_OVRLD(5, true, NONE, {
-            push(&stk, pop(&stk) * pop(&stk) / precision);
+        CMD_OVRLD(70, IS_REG_REG, REG_REG, {
+            GET_REG_REG_ARGS
+            registers[arg2] = numMul(registers[arg2], registers[arg]);
+            flags = compareFlags(registers[arg2], 0);
+        })
+        CMD_OVRLD(71, IS_REG_NUMBER, REG_NUMBER, {
+            GET_REG_NUMBER_ARGS
+            registers[arg2] *= arg;
+            flags = compareFlags(registers[arg2], 0);
+        })
+        CMD_OVRLD(5, *sarg == '\0', NONE, {
+            push(&stk, numMul(pop(&stk), pop(&stk)));
         }))
 
 DEF_CMD(div, 0,
-        CMD_OVRLD(6, true, NONE, {
-            int a = pop(&stk);
-            int b = pop(&stk);
+        CMD_OVRLD(72, IS_REG_REG, REG_REG, {
+            GET_REG_REG_ARGS
+            if (registers[arg] == 0) {
+                printf(ANSI_COLOR_RED "Zero division error. Terminating...\n" ANSI_COLOR_RESET);
+                return 0;
+            }
+            registers[arg2] = numDiv(registers[arg2], registers[arg]);
+            flags = compareFlags(registers[arg2], 0);
+        })
+        CMD_OVRLD(73, IS_REG_NUMBER, REG_NUMBER, {
+            GET_REG_NUMBER_ARGS
+            if (arg == 0) {
+                printf(ANSI_COLOR_RED "Zero division error. Terminating...\n" ANSI_COLOR_RESET);
+                return 0;
+            }
+            registers[arg2] /= arg;
+            flags = compareFlags(registers[arg2], 0);
+        })
+        CMD_OVRLD(6, *sarg == '\0', NONE, {
+            num_t a = pop(&stk);
+            num_t b = pop(&stk);
 
             if (b == 0) {
                 printf(ANSI_COLOR_RED "Zero division error. Terminating...\n" ANSI_COLOR_RESET);
                 return 0;
             }
-            push(&stk, (int)((precision * a) / b));
+            push(&stk, numDiv(a, b));
         }))
 
+DEF_CMD(cmp, 2,
+        CMD_OVRLD(74, IS_REG_REG, REG_REG, {
+            GET_REG_REG_ARGS
+            flags = compareFlags(registers[arg2], registers[arg]);
+        })
+        CMD_OVRLD(75, IS_REG_NUMBER, REG_FIXED, {
+            GET_REG_NUMBER_ARGS
+            flags = compareFlags(registers[arg2], numFromImmediate(arg));
+        }))
+
+DEF_CMD(dup, 0,
+        CMD_OVRLD(84, true, NONE, {
+            pick(&stk, 0);
+        }))
+
+DEF_CMD(drop, 0,
+        CMD_OVRLD(85, true, NONE, {
+            pop(&stk);
+        }))
+
+DEF_CMD(swap, 0,
+        CMD_OVRLD(86, true, NONE, {
+            roll(&stk, 1);
+        }))
+
+DEF_CMD(over, 0,
+        CMD_OVRLD(87, true, NONE, {
+            pick(&stk, 1);
+        }))
+
+DEF_CMD(rot, 0,
+        CMD_OVRLD(88, true, NONE, {
+            roll(&stk, 2);
+        }))
+
+DEF_CMD(pick, 1,
+        CMD_OVRLD(89, isdigit(*sarg), NUMBER, {
+            GET_INT_ARG
+            pick(&stk, arg);
+        }))
 
 DEF_CMD(end, 0,
         CMD_OVRLD(7, true, NONE, {
@@ -115,26 +247,72 @@ DEF_CMD(end, 0,
 
 DEF_CMD(in, 0,
         CMD_OVRLD(8, true, NONE, {
-            push(&stk, get_int() * precision);
+            push(&stk, numFromInt(get_int()));
+            irqRearmInput(irq);
 }))
 
+// Non-blocking keyboard, see keyboard.h. key pushes -1 if no key has been pressed, keyready pushes number of buffered keys.
+DEF_CMD(key, 0,
+        CMD_OVRLD(114, true, NONE, {
+            if (!keyboardStart(keyboard)) {
+                printf(ANSI_COLOR_RED "Unable to start keyboard. Terminating...\n" ANSI_COLOR_RESET);
+                return 0;
+            }
+            push(&stk, numFromInt(keyboardRead(keyboard)));
+        }))
+
+DEF_CMD(keyready, 0,
+        CMD_OVRLD(115, true, NONE, {
+            if (!keyboardStart(keyboard)) {
+                printf(ANSI_COLOR_RED "Unable to start keyboard. Terminating...\n" ANSI_COLOR_RESET);
+                return 0;
+            }
+            push(&stk, numFromInt(keyboardReady(keyboard)));
+        }))
+
 DEF_CMD(out, 0,
         CMD_OVRLD(9, true, NONE, {
-            printf("%.2lf\n", (double) peak_n(&stk, 1) / precision);
+            numPrint(stdout, peak_n(&stk, 1));
         }))
 
 DEF_CMD(nop, 0,
         CMD_OVRLD(0, true, NONE, {}))
 
+#define PUSH_RETURN_ADDRESS \
+            if (callDepth >= CALL_STACK_DEPTH) { \
+                printf(ANSI_COLOR_RED "Call stack overflow error! Terminating..." ANSI_COLOR_RESET); \
+                return 0; \
+            } \
+            calls[callDepth++] = bin - binStart + 1;
+
+// Calls of pure functions with cached results are skipped, see memo.h
+#define CALL_FUNCTION \
+            if ((arg >= 0) && (arg < len) && (binStart[arg] == PURE_OPCODE) && \
+                memoCall(memo, &stk, binStart + arg, arg, len, callDepth, bin - binStart + 1)) { \
+                bin += sizeof(int); \
+            } else { \
+                PUSH_RETURN_ADDRESS \
+                bin = binStart + arg - 1; \
+            }
+
 DEF_CMD(call, 1,
+        CMD_OVRLD(96, isIndexOperand(sarg), INDEX, {
+            GET_INDEX_ARG
+            arg = indexes[arg];
+            if ((arg >= len) || (arg < 0)) {
+                printf(ANSI_COLOR_RED "Calling function outside the program. Terminating..." ANSI_COLOR_RESET);
+                return 0;
+            }
+            bin -= sizeof(int); // return address is taken relative to the opcode, as for the label form
+            CALL_FUNCTION
+        })
         CMD_OVRLD(10, true, LABEL, {
             arg = *((int *)(bin + 1));
             if ((arg >= len) || (arg < 0)) {
                 printf(ANSI_COLOR_RED "Calling function outside the program. Terminating..." ANSI_COLOR_RESET);
                 return 0;
             }
-            push(&stk, bin - binStart + 1);
-            bin = binStart + arg - 1;
+            CALL_FUNCTION
         })
         CMD_OVRLD(12, true, NUMBER, {
             arg = *((int *)(bin + 1));
@@ -142,52 +320,176 @@ DEF_CMD(call, 1,
                 printf(ANSI_COLOR_RED "Calling function outside the program. Terminating..." ANSI_COLOR_RESET);
                 return 0;
             }
-            push(&stk, bin - binStart + 1);
-            bin = binStart + arg - 1;
+            CALL_FUNCTION
         }))
 
+// Return addresses are kept on the call stack, so they are always inside the program
 DEF_CMD(ret, 0,
         CMD_OVRLD(13, true, NONE, {
-            arg = pop(&stk);
-            if((arg >= len) || (arg < 0)) {
-                printf(ANSI_COLOR_RED "Returning outside the program. Terminating..." ANSI_COLOR_RESET);
+            if (callDepth == 0) {
+                printf(ANSI_COLOR_RED "Returning with empty call stack. Terminating..." ANSI_COLOR_RESET);
+                return 0;
+            }
+            bin = binStart + calls[--callDepth] + sizeof(int) - 1;
+            if (memo->pendingNum) memoReturn(memo, &stk, callDepth, calls[callDepth]);
+        }))
+
+// Marks the start of a pure function that takes "in" values from the stack and leaves "out" results
+DEF_CMD(pure, 2,
+        CMD_OVRLD(105, isdigit(*sarg) && isdigit(*sarg2), NUMBER_NUMBER, {
+            bin += 2 * sizeof(int);
+        }))
+
+// Calls native function n registered by the VM or a plugin, see vmapi.h
+DEF_CMD(sys, 1,
+        CMD_OVRLD(106, isdigit(*sarg), NUMBER, {
+            GET_INT_ARG
+            const native_entry_t *native = nativesFind(natives, arg);
+            if (!native) {
+                printf(ANSI_COLOR_RED "Unknown native function %d. Terminating...\n" ANSI_COLOR_RESET, arg);
+                return 0;
+            }
+            if (!native->function(natives, &vmApi)) {
+                printf(ANSI_COLOR_RED "Native function %s failed. Terminating...\n" ANSI_COLOR_RESET, native->name ? native->name : "");
                 return 0;
             }
-            bin = binStart + arg + sizeof(int) - 1;
+        }))
+
+// Frame is the saved bp followed by n locals addressed as [bp+0] .. [bp+n-1]
+DEF_CMD(enter, 1,
+        CMD_OVRLD(92, isdigit(*sarg), NUMBER, {
+            GET_INT_ARG
+            if ((arg < 0) || (arg >= FRAME_REGION_SIZE - frameTop)) {
+                printf(ANSI_COLOR_RED "Frame region overflow error! Terminating..." ANSI_COLOR_RESET);
+                return 0;
+            }
+            frames[frameTop] = bp;
+            bp = frameTop + 1;
+            frameTop = bp + arg;
+        }))
+
+DEF_CMD(leave, 0,
+        CMD_OVRLD(93, true, NONE, {
+            if (bp == 0) {
+                printf(ANSI_COLOR_RED "Leaving with no frame entered. Terminating..." ANSI_COLOR_RESET);
+                return 0;
+            }
+            frameTop = bp - 1;
+            bp = frames[frameTop];
         }))
 
 DEF_CMD(sqrt, 0,
         CMD_OVRLD(14, true, NONE, {
-            push(&stk, (int)round(sqrt((double) pop(&stk) / precision) * precision));
+            push(&stk, numSqrt(pop(&stk)));
         }))
 
 DEF_CMD(inc, 1,
+        CMD_OVRLD(60, isIndexOperand(sarg), INDEX, {
+            GET_INDEX_ARG
+            indexes[arg]++;
+        })
         CMD_OVRLD(15, true, REGISTER, {
+            GET_REG_ARG
+            registers[arg] += NUM_ONE;
+            flags = compareFlags(registers[arg], 0);
+        }))
+
+DEF_CMD(loop, 2,
+        CMD_OVRLD(83, isIndexOperand(sarg), INDEX_LABEL, {
+            GET_INDEX_ARG
+            int arg2 = arg;
             GET_INT_ARG
-            if(arg >= 4) {
-                printf(ANSI_COLOR_RED "Invalid register number %d. Terminating..." ANSI_COLOR_RESET, arg);
-                return 0;
+            if (--indexes[arg2] != 0) {
+                if ((arg >= len) || (arg < 0)) {
+                    printf(ANSI_COLOR_RED "Jumping outside the program. Terminating..." ANSI_COLOR_RESET);
+                    return 0;
+                }
+                bin = binStart + arg - 1;
+            }
+        })
+        CMD_OVRLD(82, isalpha(*sarg), REG_LABEL, {
+            GET_REG_ARG
+            int arg2 = arg;
+            GET_INT_ARG
+            registers[arg2] -= NUM_ONE;
+            if (registers[arg2] != 0) {
+                if ((arg >= len) || (arg < 0)) {
+                    printf(ANSI_COLOR_RED "Jumping outside the program. Terminating..." ANSI_COLOR_RESET);
+                    return 0;
+                }
+                bin = binStart + arg - 1;
             }
-            registers[arg] += precision;
         }))
 
-DEF_CMD(pix, 1,
+DEF_CMD(pix, 0,
+        CMD_OVRLD(37, isdigit(*sarg), PIXEL, {
+            GET_INT_ARG
+            setPixelXY(VRAM, (unsigned int) arg >> 16, ((unsigned int) arg >> 4) & 0xFFF, arg & 0xF);
+        })
+        CMD_OVRLD(38, *sarg == '\0', NONE, {
+            int color = numToInt(pop(&stk));
+            int y = numToInt(pop(&stk));
+            setPixelXY(VRAM, numToInt(pop(&stk)), y, color);
+        })
+        CMD_OVRLD(61, isIndexOperand(sarg), INDEX, {
+            GET_INDEX_ARG
+            arg = indexes[arg];
+            setPixelXY(VRAM, (unsigned int) arg >> 16, ((unsigned int) arg >> 4) & 0xFFF, arg & 0xF);
+        })
         CMD_OVRLD(16, isdigit(*sarg), NUMBER, {
             GET_INT_ARG
             setPixel(VRAM, arg);
         })
+        // Register keeps the decimal x*10000 + y*10 + color descriptor for existing programs,
+        // computed coordinates are better passed with the stack or index register forms
         CMD_OVRLD(17, isalpha(*sarg), REGISTER, {
+            GET_REG_ARG
+            setPixel(VRAM, numToInt(registers[arg]));
+        }))
+
+DEF_CMD(ldx, 2,
+        CMD_OVRLD(97, isIndexOperand(sarg) && isalpha(*sarg2) && (parseRegister(sarg2) == -1), INDEX_LABEL, {
+            GET_INDEX_ARG
+            int arg2 = arg;
             GET_INT_ARG
-            if(arg >= 4) {
-                printf(ANSI_COLOR_RED "Invalid register number %d. Terminating..." ANSI_COLOR_RESET, arg);
-                return 0;
-            }
-            setPixel(VRAM, registers[arg] / precision);
+            indexes[arg2] = arg;
+        })
+        CMD_OVRLD(62, isIndexOperand(sarg), INDEX_REG, {
+            GET_INDEX_ARG
+            int arg2 = arg;
+            GET_REG_ARG
+            indexes[arg2] = numToInt(registers[arg]);
+        }))
+
+DEF_CMD(stx, 2,
+        CMD_OVRLD(63, isIndexOperand(sarg2), REG_INDEX, {
+            GET_REG_ARG
+            int arg2 = arg;
+            GET_INDEX_ARG
+            registers[arg2] = numFromInt(indexes[arg]);
         }))
 
 DEF_CMD(draw, 0,
         CMD_OVRLD(18, true, NONE, {
-            drawScreen(VRAM);
+            presentFrame(&devices);
+        }))
+
+DEF_CMD(tileset, 1,
+        CMD_OVRLD(34, isdigit(*sarg) || (*sarg == '-'), NUMBER, {
+            GET_INT_ARG
+            display.tileset = arg;
+        }))
+
+DEF_CMD(tilemap, 1,
+        CMD_OVRLD(35, isdigit(*sarg) || (*sarg == '-'), NUMBER, {
+            GET_INT_ARG
+            display.tilemap = arg;
+        }))
+
+DEF_CMD(sprites, 1,
+        CMD_OVRLD(36, isdigit(*sarg) || (*sarg == '-'), NUMBER, {
+            GET_INT_ARG
+            display.sprites = arg;
         }))
 
 DEF_CMD(delay, 1,
@@ -196,7 +498,197 @@ DEF_CMD(delay, 1,
             usleep(arg * 1000);
         }))
 
+// Performance counters, see perf.h. Values wrap around at the largest integer of the numeric model.
+DEF_CMD(rdcycle, 0,
+        CMD_OVRLD(116, true, NONE, {
+            push(&stk, numFromCounter(perf.retired));
+        }))
+
+DEF_CMD(rdperf, 1,
+        CMD_OVRLD(117, isdigit(*sarg), NUMBER, {
+            GET_INT_ARG
+            unsigned long long value = 0;
+            if (!perfRead(&perf, RAM, arg, &value)) {
+                printf(ANSI_COLOR_RED "Unknown performance counter %d. Terminating...\n" ANSI_COLOR_RESET, arg);
+                return 0;
+            }
+            push(&stk, numFromCounter(value));
+        }))
+
+// Interrupts, see irq.h. Handlers run with interrupts disabled, iret restores flags and enables them.
+DEF_CMD(ivt, 1,
+        CMD_OVRLD(108, isdigit(*sarg) || (*sarg == '-'), NUMBER, {
+            GET_INT_ARG
+            if (!irqStart(irq, arg)) {
+                printf(ANSI_COLOR_RED "Unable to start interrupt controller. Terminating...\n" ANSI_COLOR_RESET);
+                return 0;
+            }
+        }))
+
+DEF_CMD(tmr, 1,
+        CMD_OVRLD(109, isdigit(*sarg), NUMBER, {
+            GET_INT_ARG
+            irqSetTimer(irq, arg);
+        }))
+
+DEF_CMD(iret, 0,
+        CMD_OVRLD(110, true, NONE, {
+            if (callDepth < 2) {
+                printf(ANSI_COLOR_RED "Returning from interrupt with empty call stack. Terminating..." ANSI_COLOR_RESET);
+                return 0;
+            }
+            bin = binStart + calls[--callDepth] - 1;
+            flags = calls[--callDepth];
+            irq->enabled = true;
+        }))
+
+DEF_CMD(cli, 0,
+        CMD_OVRLD(111, true, NONE, {
+            irq->enabled = false;
+        }))
+
+DEF_CMD(sti, 0,
+        CMD_OVRLD(112, true, NONE, {
+            irq->enabled = true;
+        }))
+
+// Sleeps until an interrupt that has a handler is raised
+DEF_CMD(hlt, 0,
+        CMD_OVRLD(113, true, NONE, {
+            unsigned int handled = irqHandlers(RAM, irq);
+            if (!irq->enabled || !handled) {
+                printf(ANSI_COLOR_RED "Halted with no interrupt to wake up. Terminating..." ANSI_COLOR_RESET);
+                return 0;
+            }
+            irqWait(irq, handled);
+        }))
+
+DEF_CMD(mcpy, 0,
+        CMD_OVRLD(39, true, NONE, {
+            int count = numToInt(pop(&stk));
+            int src = numToInt(pop(&stk));
+            copyRAM(RAM, numToInt(pop(&stk)), src, count);
+        }))
+
+DEF_CMD(mset, 0,
+        CMD_OVRLD(40, true, NONE, {
+            int count = numToInt(pop(&stk));
+            num_t value = pop(&stk);
+            fillRAM(RAM, numToInt(pop(&stk)), value, count);
+        }))
+
+DEF_CMD(mcmp, 0,
+        CMD_OVRLD(44, true, NONE, {
+            int count = numToInt(pop(&stk));
+            int second = numToInt(pop(&stk));
+            push(&stk, numFromInt(compareRAM(RAM, numToInt(pop(&stk)), second, count)));
+        }))
+
+// Vector operations on RAM ranges: dst, a, b, count for element-wise ones, a, b, count for vdot and a, count for vsum
+#define DEF_VECTOR_OP(name, opcode, kernel) \
+DEF_CMD(name, 0, \
+        CMD_OVRLD(opcode, true, NONE, { \
+            int count = numToInt(pop(&stk)); \
+            num_t *b = getRAMBlock(RAM, numToInt(pop(&stk)), count); \
+            num_t *a = getRAMBlock(RAM, numToInt(pop(&stk)), count); \
+            kernel(getRAMBlock(RAM, numToInt(pop(&stk)), count), a, b, count); \
+        }))
+
+DEF_VECTOR_OP(vadd, 98, vectorAdd)
+DEF_VECTOR_OP(vsub, 99, vectorSub)
+DEF_VECTOR_OP(vmul, 100, vectorMul)
+DEF_VECTOR_OP(vmin, 101, vectorMin)
+DEF_VECTOR_OP(vmax, 102, vectorMax)
+
+#undef DEF_VECTOR_OP
+
+DEF_CMD(vdot, 0,
+        CMD_OVRLD(103, true, NONE, {
+            int count = numToInt(pop(&stk));
+            num_t *b = getRAMBlock(RAM, numToInt(pop(&stk)), count);
+            push(&stk, vectorDot(getRAMBlock(RAM, numToInt(pop(&stk)), count), b, count));
+        }))
+
+DEF_CMD(vsum, 0,
+        CMD_OVRLD(104, true, NONE, {
+            int count = numToInt(pop(&stk));
+            push(&stk, vectorSum(getRAMBlock(RAM, numToInt(pop(&stk)), count), count));
+        }))
+
+DEF_CMD(blit, 0,
+        CMD_OVRLD(45, true, NONE, {
+            int count = numToInt(pop(&stk));
+            int src = numToInt(pop(&stk));
+            blitRAM(VRAM, RAM, numToInt(pop(&stk)), src, count);
+        }))
+
+DEF_CMD(dmacpy, 0,
+        CMD_OVRLD(46, true, NONE, {
+            dma_job_t job = {};
+            job.type = DMA_COPY;
+            job.count = numToInt(pop(&stk));
+            job.from = getRAMBlock(RAM, numToInt(pop(&stk)), job.count);
+            job.to = getRAMBlock(RAM, numToInt(pop(&stk)), job.count);
+            dmaSubmit(dma, &job);
+        }))
+
+DEF_CMD(dmaset, 0,
+        CMD_OVRLD(47, true, NONE, {
+            dma_job_t job = {};
+            job.type = DMA_FILL;
+            job.count = numToInt(pop(&stk));
+            job.value = pop(&stk);
+            job.to = getRAMBlock(RAM, numToInt(pop(&stk)), job.count);
+            dmaSubmit(dma, &job);
+        }))
+
+DEF_CMD(dmablit, 0,
+        CMD_OVRLD(48, true, NONE, {
+            dma_job_t job = {};
+            job.type = DMA_BLIT;
+            job.count = numToInt(pop(&stk));
+            job.from = getRAMBlock(RAM, numToInt(pop(&stk)), job.count);
+            job.vram = getVRAMBlock(VRAM, numToInt(pop(&stk)), job.count);
+            dmaSubmit(dma, &job);
+        }))
+
+DEF_CMD(dmapoll, 0,
+        CMD_OVRLD(49, true, NONE, {
+            push(&stk, numFromInt(dmaIdle(dma)));
+        }))
+
+DEF_CMD(dmawait, 0,
+        CMD_OVRLD(50, true, NONE, {
+            dmaWait(dma);
+        }))
+
+DEF_CMD(sync, 0,
+        CMD_OVRLD(51, true, NONE, {
+            if (!ramSync(RAM)) {
+                printf(ANSI_COLOR_RED "Unable to sync RAM with its file. Terminating...\n" ANSI_COLOR_RESET);
+                return 0;
+            }
+        }))
+
+DEF_CMD(snap, 0,
+        CMD_OVRLD(55, true, NONE, {
+            dmaWait(dma);
+            if (!checkpoint(&cpu, params->snapshotFile, binStart, len, bin - binStart + 1, &snapshotWriter)) {
+                printf(ANSI_COLOR_RED "Unable to take snapshot %s. Terminating...\n" ANSI_COLOR_RESET, params->snapshotFile);
+                return 0;
+            }
+        }))
+
 DEF_CMD(jmp, 1,
+        CMD_OVRLD(95, isIndexOperand(sarg), INDEX, {
+            GET_INDEX_ARG
+            arg = indexes[arg];
+            if ((arg >= len) || (arg < 0)) {
+                printf(ANSI_COLOR_RED "Jumping outside the program. Terminating..." ANSI_COLOR_RESET);
+                return 0;
+            }
+            bin = binStart + arg - 1;
+        })
         CMD_OVRLD(20, isalpha(*sarg), LABEL, {
             arg = *((int *)(bin + 1));
             if ((arg >= len) || (arg < 0)) {
@@ -214,6 +706,29 @@ DEF_CMD(jmp, 1,
             bin = binStart + arg - 1;
         }))
 
+// Followed by a jump table emitted by the "table" directive: entries count and addresses.
+// Out of range index falls through to the instruction after the table.
+DEF_CMD(switch, 1,
+        CMD_OVRLD(94, isIndexOperand(sarg), INDEX, {
+            GET_INDEX_ARG
+            arg = indexes[arg];
+            int count = *((int *)(bin + 1));
+            if ((count < 0) || (count > (len - (bin - binStart) - 1) / (int) sizeof(int) - 1)) {
+                printf(ANSI_COLOR_RED "Invalid jump table. Terminating..." ANSI_COLOR_RESET);
+                return 0;
+            }
+            if ((arg < 0) || (arg >= count)) {
+                bin += (count + 1) * sizeof(int);
+            } else {
+                arg = *((int *)(bin + 1) + 1 + arg);
+                if ((arg >= len) || (arg < 0)) {
+                    printf(ANSI_COLOR_RED "Jumping outside the program. Terminating..." ANSI_COLOR_RESET);
+                    return 0;
+                }
+                bin = binStart + arg - 1;
+            }
+        }))
+
 #define DEF_JMP(name, opcode, cond) \
 DEF_CMD(name, 1, \
         CMD_OVRLD(opcode, isalpha(*sarg), LABEL, { \
@@ -248,6 +763,30 @@ DEF_JMP(jne, 32, !=)
 
 #undef DEF_JMP
 
+// Jumps on flags set by cmp and register arithmetic
+#define DEF_FLAG_JMP(name, opcode, cond) \
+DEF_CMD(name, 1, \
+        CMD_OVRLD(opcode, isalpha(*sarg), LABEL, { \
+            if(cond) { \
+                arg = *((int *)(bin + 1)); \
+                if ((arg >= len) || (arg < 0)) { \
+                    printf(ANSI_COLOR_RED "Jumping outside the program. Terminating..." ANSI_COLOR_RESET); \
+                    return 0; \
+                } \
+                bin = binStart + arg - 1; \
+            } \
+            else bin += sizeof(int); \
+        }))
+
+DEF_FLAG_JMP(jz, 76, flags & FLAG_ZERO)
+DEF_FLAG_JMP(jnz, 77, !(flags & FLAG_ZERO))
+DEF_FLAG_JMP(jl, 78, flags & FLAG_LESS)
+DEF_FLAG_JMP(jle, 79, flags & (FLAG_LESS | FLAG_ZERO))
+DEF_FLAG_JMP(jg, 80, !(flags & (FLAG_LESS | FLAG_ZERO)))
+DEF_FLAG_JMP(jge, 81, !(flags & FLAG_LESS))
+
+#undef DEF_FLAG_JMP
+
 // Check non zero division
 // nand2tetris.org
 // Физтеховский курс по FPGA
@@ -0,0 +1,12 @@
+# Numeric model shared by the VM and the assembler, see numeric.h
+set(NUMERIC_MODEL fixed CACHE STRING "Type of VM values: fixed, q16, int64 or double")
+set_property(CACHE NUMERIC_MODEL PROPERTY STRINGS fixed q16 int64 double)
+if (NUMERIC_MODEL STREQUAL "q16")
+    add_compile_definitions(NUMERIC_Q16)
+elseif (NUMERIC_MODEL STREQUAL "int64")
+    add_compile_definitions(NUMERIC_INT64)
+elseif (NUMERIC_MODEL STREQUAL "double")
+    add_compile_definitions(NUMERIC_DOUBLE)
+elseif (NOT NUMERIC_MODEL STREQUAL "fixed")
+    message(FATAL_ERROR "Unknown NUMERIC_MODEL ${NUMERIC_MODEL}")
+endif ()
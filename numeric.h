@@ -0,0 +1,215 @@
+#include <math.h>
+#include <stdio.h>
+
+#ifndef NUMERIC_H
+#define NUMERIC_H
+
+// Type of values in registers, stack and RAM, chosen at compile time with the NUMERIC_MODEL cmake option.
+// Fixed-point models keep values multiplied by NUM_ONE, native models keep them as is.
+// With NUM_SCALED_IMMEDIATES the assembler stores immediates already multiplied by NUM_ONE,
+// so the assembler has to be built with the same model as the VM.
+#if defined(NUMERIC_DOUBLE)
+
+typedef double num_t;
+
+const num_t NUM_ONE = 1;
+
+const unsigned int NUMERIC_MODEL_ID = 2;
+
+// Largest integer that is represented exactly
+const long long NUM_MAX_INT = 1ll << 53;
+
+const bool NUM_SCALED_IMMEDIATES = false;
+
+inline num_t numMul(num_t a, num_t b) {
+    return a * b;
+}
+
+inline num_t numDiv(num_t a, num_t b) {
+    return a / b;
+}
+
+inline num_t numSqrt(num_t a) {
+    return sqrt(a);
+}
+
+inline void numPrint(FILE *f, num_t a) {
+    fprintf(f, "%.15lg\n", a);
+}
+
+#elif defined(NUMERIC_INT64)
+
+typedef long long num_t;
+
+const num_t NUM_ONE = 1;
+
+const unsigned int NUMERIC_MODEL_ID = 1;
+
+const long long NUM_MAX_INT = 0x7FFFFFFFFFFFFFFFll;
+
+const bool NUM_SCALED_IMMEDIATES = false;
+
+inline num_t numMul(num_t a, num_t b) {
+    return a * b;
+}
+
+inline num_t numDiv(num_t a, num_t b) {
+    return a / b;
+}
+
+inline num_t numSqrt(num_t a) {
+    return (num_t) sqrt((double) a);
+}
+
+inline void numPrint(FILE *f, num_t a) {
+    fprintf(f, "%lld\n", a);
+}
+
+#elif defined(NUMERIC_Q16)
+
+// Q16.16: binary scaling turns rescaling into shifts
+typedef int num_t;
+
+const int NUM_FRACTION_BITS = 16;
+
+const num_t NUM_ONE = 1 << NUM_FRACTION_BITS;
+
+const unsigned int NUMERIC_MODEL_ID = 3;
+
+const long long NUM_MAX_INT = 0x7FFF;
+
+const bool NUM_SCALED_IMMEDIATES = true;
+
+const int NUM_PRINT_DIGITS = 4;
+
+inline num_t numMul(num_t a, num_t b) {
+    return (num_t) (((long long) a * b) >> NUM_FRACTION_BITS);
+}
+
+inline num_t numDiv(num_t a, num_t b) {
+    return (num_t) (((long long) a << NUM_FRACTION_BITS) / b);
+}
+
+// Bit-by-bit square root of a * NUM_ONE, negative values give 0
+inline num_t numSqrt(num_t a) {
+    if (a <= 0) return 0;
+
+    unsigned long long value = (unsigned long long) a << NUM_FRACTION_BITS;
+    unsigned long long root = 0;
+    unsigned long long bit = 1ull << 62;
+    while (bit > value)
+        bit >>= 2;
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (num_t) root;
+}
+
+// Formats NUM_PRINT_DIGITS rounded decimals with integer arithmetic only
+inline void numPrint(FILE *f, num_t a) {
+    char buffer[32] = "";
+    char *digit = buffer + sizeof(buffer) - 1;
+    unsigned long long scale = 1;
+    for (int i = 0; i < NUM_PRINT_DIGITS; i++)
+        scale *= 10;
+
+    unsigned long long value = (a < 0) ? -(long long) a : a;
+    value = (value * scale + NUM_ONE / 2) >> NUM_FRACTION_BITS;
+
+    *--digit = '\n';
+    for (int i = 0; i < NUM_PRINT_DIGITS; i++, value /= 10)
+        *--digit = (char) ('0' + value % 10);
+    *--digit = '.';
+    do {
+        *--digit = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value);
+    if (a < 0) *--digit = '-';
+
+    fputs(digit, f);
+}
+
+#else
+
+typedef int num_t;
+
+const num_t NUM_ONE = 100;
+
+const unsigned int NUMERIC_MODEL_ID = 0;
+
+const long long NUM_MAX_INT = 0x7FFFFFFF / NUM_ONE;
+
+const bool NUM_SCALED_IMMEDIATES = false;
+
+inline num_t numMul(num_t a, num_t b) {
+    return (num_t) ((long long) a * b / NUM_ONE);
+}
+
+inline num_t numDiv(num_t a, num_t b) {
+    return (num_t) ((long long) a * NUM_ONE / b);
+}
+
+inline num_t numSqrt(num_t a) {
+    return (num_t) round(sqrt((double) a / NUM_ONE) * NUM_ONE);
+}
+
+inline void numPrint(FILE *f, num_t a) {
+    fprintf(f, "%.2lf\n", (double) a / NUM_ONE);
+}
+
+#endif
+
+inline num_t numFromInt(long long value) {
+    return (num_t) (value * NUM_ONE);
+}
+
+// Integer part, used for addresses, counts and colors
+inline long long numToInt(num_t value) {
+#if defined(NUMERIC_Q16)
+    return value >> NUM_FRACTION_BITS;
+#else
+    return (long long) (value / NUM_ONE);
+#endif
+}
+
+// Conversions for native routines that compute in floating point
+inline double numToDouble(num_t value) {
+    return (double) value / NUM_ONE;
+}
+
+// Whether numFromDouble gives a meaningful value: NaN, infinities and values out of num_t range do not
+inline bool numFitsDouble(double value) {
+#if defined(NUMERIC_DOUBLE)
+    return isfinite(value);
+#else
+    double scaled = value * NUM_ONE;
+    double limit = ldexp(1.0, sizeof(num_t) * 8 - 1);
+    return isfinite(scaled) && (scaled >= -limit) && (scaled < limit);
+#endif
+}
+
+inline num_t numFromDouble(double value) {
+#if defined(NUMERIC_DOUBLE)
+    return value;
+#else
+    return (num_t) llround(value * NUM_ONE);
+#endif
+}
+
+// Counters wrap around at NUM_MAX_INT, so differences of close readings stay meaningful modulo NUM_MAX_INT + 1
+inline num_t numFromCounter(unsigned long long value) {
+    return numFromInt((long long) (value % ((unsigned long long) NUM_MAX_INT + 1)));
+}
+
+// Value of an immediate operand of push, mov, add, sub and cmp
+inline num_t numFromImmediate(int arg) {
+    return NUM_SCALED_IMMEDIATES ? (num_t) arg : numFromInt(arg);
+}
+
+#endif //NUMERIC_H